@@ -14,13 +14,15 @@ project "RayTracing"
       "../Walnut/vendor/glm",
 
       "../Walnut/Walnut/src",
+      "../RayTracingCore/src",
 
       "%{IncludeDir.VulkanSDK}",
    }
 
    links
    {
-       "Walnut"
+       "Walnut",
+       "RayTracingCore"
    }
 
    targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
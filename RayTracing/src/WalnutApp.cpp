@@ -4,10 +4,14 @@
 #include "Walnut/Image.h"
 #include "Walnut/Timer.h"
 
-#include "renderer.h"
+#include "render_thread.h"
 #include "camera.h"
+#include "camera_controller.h"
+#include "scene_file.h"
+#include "mesh_io.h"
 
 #include <glm/gtc/type_ptr.hpp>
+#include <cstdio>
 #include <limits>
 
 using namespace Walnut;
@@ -15,37 +19,267 @@ using namespace Walnut;
 class ExampleLayer : public Walnut::Layer
 {
 public:
-	ExampleLayer()
+	ExampleLayer(const std::string& sceneFile = {})
 		: m_Camera(60.0f, 0.1f, 100.0f) 
 	{
 		m_Scene.materials.emplace_back(std::make_unique<emissive>());
+
+		if (!sceneFile.empty())
+		{
+			std::snprintf(m_SceneFilePath, sizeof(m_SceneFilePath), "%s", sceneFile.c_str());
+			LoadScene();
+		}
 	}
 
+	// the render thread sees the camera move by itself and restarts or reprojects the accumulation
 	virtual void OnUpdate(float ts)
 	{
-		if(m_Camera.on_update(ts))
-			m_Renderer.resetFrameIndex();
+		m_CameraController.on_update(m_Camera, ts);
 	}
 
 	virtual void OnUIRender() override
 	{
 		bool changed = false;
+		std::vector<int> dirtyObjects;
 
 		ImGui::Begin("Settings");
 		{
-			ImGui::Text("Last render: %.3fms", m_LastRenderTime);
-			ImGui::Text("FPS: %.1f", 1000.0f / m_LastRenderTime);
+			// the UI never waits for the render thread, these describe the newest frame it finished
+			const render_thread::frame& frame = m_RenderThread.get_frame();
+			ImGui::Text("Last render: %.3fms, %u samples", frame.renderMs, frame.samples);
+			ImGui::Text("Render FPS: %.1f, UI FPS: %.1f", 1000.0f / std::max(frame.renderMs, 0.001f), ImGui::GetIO().Framerate);
+
+			const char* integrators[] = { "Megakernel", "Wavefront" };
+			int integrator = (int)m_RenderSettings.integrator;
+			if (ImGui::Combo("Integrator", &integrator, integrators, IM_ARRAYSIZE(integrators)))
+			{
+				m_RenderSettings.integrator = (renderer::integrator_mode)integrator;
+			}
+
+			ImGui::Checkbox("Camera Ray Packets", &m_RenderSettings.primaryPackets);
 
-			if (ImGui::Button("Render"))
+			if (ImGui::Checkbox("Sample Lights", &m_RenderSettings.nextEventEstimation))
 			{
-				Render();
+				m_Restart = true;
+			}
+
+			if (ImGui::DragInt("Max Bounces", &m_RenderSettings.rayDepth, 1.0f, 1, 1024))
+			{
+				m_Restart = true;
+			}
+
+			if (ImGui::Checkbox("Russian Roulette", &m_RenderSettings.russianRoulette))
+			{
+				m_Restart = true;
+			}
+
+			ImGui::BeginDisabled(!m_RenderSettings.russianRoulette);
+			if (ImGui::DragInt("Roulette Depth", &m_RenderSettings.rouletteDepth, 1.0f, 1, 64))
+			{
+				m_Restart = true;
+			}
+			ImGui::EndDisabled();
+
+			ImGui::Checkbox("Accumulate", &m_RenderSettings.accumulate);
+
+			ImGui::BeginDisabled(!m_RenderSettings.accumulate);
+			ImGui::Checkbox("Reproject On Camera Move", &m_RenderSettings.reproject);
+			if (m_RenderSettings.reproject)
+			{
+				ImGui::DragInt("History Length", &m_RenderSettings.historyLength, 1.0f, 1, 4096);
+				ImGui::DragFloat("Depth Tolerance", &m_RenderSettings.reprojectDepthTolerance, 0.005f, 0.0f, 1.0f, "%.3f");
+				ImGui::DragFloat("Normal Cosine", &m_RenderSettings.reprojectNormalCosine, 0.01f, -1.0f, 1.0f, "%.2f");
+
+				if (frame.width > 0)
+				{
+					ImGui::Text("Reprojected: %.1f%% of the last move", 100.0f * frame.reprojectedPixels / (float)(frame.width * frame.height));
+				}
 			}
+			ImGui::EndDisabled();
 
-			ImGui::Checkbox("Accumulate", &m_Renderer.getSettings().accumulate);
+			// filters what is shown only, so none of these restart the accumulation
+			ImGui::Checkbox("Denoise", &m_RenderSettings.denoise);
+			if (m_RenderSettings.denoise)
+			{
+				denoiser::settings& denoising = m_RenderSettings.denoising;
+				ImGui::DragInt("Iterations", &denoising.iterations, 0.1f, 0, 8);
+				ImGui::DragFloat("Colour Sigma", &denoising.colourSigma, 0.01f, 0.0f, 16.0f, "%.2f");
+				ImGui::DragFloat("Normal Sigma", &denoising.normalSigma, 0.01f, 0.0f, 4.0f, "%.2f");
+				ImGui::DragFloat("Depth Sigma", &denoising.depthSigma, 0.001f, 0.0f, 1.0f, "%.3f");
+				ImGui::Text("Denoise: %.3fms", frame.denoiseMs);
+			}
 
 			if (ImGui::Button("Reset"))
 			{
-				m_Renderer.resetFrameIndex();
+				m_Restart = true;
+			}
+
+			if (ImGui::DragInt("Seed", &m_RenderSettings.seed))
+			{
+				m_Restart = true;
+			}
+
+			ImGui::DragFloat("Noise Threshold", &m_RenderSettings.noiseThreshold, 0.001f, 0.0f, 1.0f, "%.3f");
+			ImGui::DragInt("Min Samples", &m_RenderSettings.minSamples, 1.0f, 2, 4096);
+
+			if (frame.width > 0)
+			{
+				float pixels = (float)(frame.width * frame.height);
+				ImGui::Text("Converged: %.1f%%", 100.0f * (1.0f - frame.activePixels / pixels));
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Scheduler");
+
+			tile_scheduler::settings& schedulerSettings = m_RenderSettings.scheduler;
+			ImGui::DragInt("Tile Size", &schedulerSettings.tileSize, 1.0f, 4, 256);
+
+			const char* orders[] = { "Scanline", "Morton", "Spiral" };
+			int order = (int)schedulerSettings.order;
+			if (ImGui::Combo("Tile Order", &order, orders, IM_ARRAYSIZE(orders)))
+			{
+				schedulerSettings.order = (tile_scheduler::tile_order)order;
+			}
+
+			ImGui::DragInt("Threads (0 = all)", &schedulerSettings.threadCount, 0.1f, 0, 256);
+			ImGui::Checkbox("Pin Threads", &schedulerSettings.pinThreads);
+
+			const tile_scheduler::frame_stats& tileStats = frame.tileStats;
+			ImGui::Text("%zu tiles on %u threads, %u stolen", frame.tileCount, frame.threadCount, tileStats.steals);
+			ImGui::Text("Tile: %.3fms min, %.3fms mean, %.3fms max", tileStats.minTileMs, tileStats.meanTileMs, tileStats.maxTileMs);
+			ImGui::Text("Imbalance: %.2f", tileStats.imbalance);
+
+			ImGui::Separator();
+			ImGui::Text("Ray Statistics");
+
+			if constexpr (!ray_stats::ENABLED)
+			{
+				ImGui::TextDisabled("Compiled out, build with RT_RAY_STATS");
+			}
+			else
+			{
+				const ray_stats& stats = frame.rayStats;
+				double rays = (double)std::max<uint64_t>(stats.rays(), 1);
+				double paths = (double)std::max<uint64_t>(stats.paths, 1);
+
+				ImGui::Text("Rays: %llu camera, %llu bounce, %llu shadow", (unsigned long long)stats.cameraRays, (unsigned long long)stats.bounceRays, (unsigned long long)stats.shadowRays);
+				ImGui::Text("  %.2f Mrays/s, %llu packets", stats.rays() / (1000.0 * frame.renderMs), (unsigned long long)stats.packets);
+				ImGui::Text("Per ray: %.1f nodes, %.1f boxes, %.1f primitives", stats.nodesVisited / rays, stats.boxTests / rays, stats.primitiveTests / rays);
+				ImGui::Text("Path depth: %.2f mean, %llu max", stats.pathDepth / paths, (unsigned long long)stats.maxPathDepth);
+				ImGui::Text("  escaped %.1f%%, light %.1f%%, absorbed %.1f%%", 100.0 * stats.escaped / paths, 100.0 * stats.reachedLight / paths, 100.0 * stats.absorbed / paths);
+				ImGui::Text("  roulette %.1f%%, bounce cap %.1f%%", 100.0 * stats.roulette / paths, 100.0 * stats.depthLimit / paths);
+
+				if (ImGui::Button("Copy as JSON"))
+				{
+					ImGui::SetClipboardText(stats.to_json().c_str());
+				}
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Debug View");
+
+			const char* debugViews[] = { "Off", "BVH Nodes", "Primitive Tests" };
+			int debugView = (int)m_RenderSettings.debugView;
+			if (ImGui::Combo("Heatmap", &debugView, debugViews, IM_ARRAYSIZE(debugViews)))
+			{
+				m_RenderSettings.debugView = (renderer::debug_view)debugView;
+				m_Restart = true;
+			}
+
+			if (m_RenderSettings.debugView != renderer::debug_view::none)
+			{
+				if constexpr (!ray_stats::ENABLED)
+				{
+					ImGui::TextDisabled("Needs the ray statistics, build with RT_RAY_STATS");
+				}
+
+				ImGui::DragInt("Heatmap Max", &m_RenderSettings.heatmapMax, 1.0f, 1, 4096);
+
+				const renderer::traversal_histogram& histogram = frame.traversalHistogram;
+				std::array<float, renderer::traversal_histogram::BIN_COUNT> bins;
+				std::copy(histogram.bins.begin(), histogram.bins.end(), bins.begin());
+
+				ImGui::PlotHistogram("##TraversalCost", bins.data(), (int)bins.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+				ImGui::Text("Per camera ray: %.2f mean, %u max", histogram.mean, histogram.max);
+				ImGui::Text("Bins of %.1f, the last holds %u pixels at %d or more", histogram.binWidth, histogram.bins.back(), m_RenderSettings.heatmapMax);
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Scene File");
+
+			ImGui::InputText("Path", m_SceneFilePath, sizeof(m_SceneFilePath));
+			if (ImGui::Button("Load"))
+			{
+				LoadScene();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Save"))
+			{
+				if (scene_file::write(m_Scene, m_SceneFilePath))
+					m_SceneFileStatus = "Saved";
+				else
+					m_SceneFileStatus = m_Scene.instances.empty() ? "Could not write the file" : "Scene files can't hold instances yet";
+			}
+			if (!m_SceneFileStatus.empty())
+			{
+				ImGui::TextWrapped("%s", m_SceneFileStatus.c_str());
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Mesh File");
+
+			ImGui::InputText("Mesh Path", m_MeshFilePath, sizeof(m_MeshFilePath));
+			if (ImGui::Button("Add Mesh"))
+			{
+				changed |= AddMesh();
+			}
+			if (!m_MeshFileStatus.empty())
+			{
+				ImGui::TextWrapped("%s", m_MeshFileStatus.c_str());
+			}
+
+			ImGui::Separator();
+			ImGui::Text("BVH");
+
+			const char* strategies[] = { "Octree", "SAH", "LBVH" };
+			int strategy = (int)m_BVHSettings.strategy;
+			if (ImGui::Combo("Build Strategy", &strategy, strategies, IM_ARRAYSIZE(strategies)))
+			{
+				m_BVHSettings.strategy = (BVH::build_strategy)strategy;
+				changed = true;
+			}
+
+			const char* layouts[] = { "Automatic", "Scalar", "BVH4", "BVH8" };
+			int layout = (int)m_BVHSettings.layout;
+			if (ImGui::Combo("Node Layout", &layout, layouts, IM_ARRAYSIZE(layouts)))
+			{
+				m_BVHSettings.layout = (BVH::node_layout)layout;
+				changed = true;
+			}
+
+			changed |= ImGui::DragInt("Max Leaf Size", &m_BVHSettings.max_leaf_size, 1.0f, 1, 64);
+			changed |= ImGui::DragInt("Max Depth", &m_BVHSettings.max_depth, 1.0f, 1, BVH::MAX_DEPTH);
+			changed |= ImGui::DragFloat("Rebuild Threshold", &m_BVHSettings.rebuild_threshold, 0.05f, 1.0f, 10.0f);
+
+			if (m_BVHSettings.strategy == BVH::build_strategy::lbvh)
+			{
+				changed |= ImGui::Checkbox("SAH Top Levels", &m_BVHSettings.lbvh_sah_top);
+			}
+
+			if (m_Scene.bvh)
+			{
+				ImGui::Text("Nodes: %zu, Leaves: %zu, Depth: %d", m_Scene.bvh->nodes.size(), m_Scene.bvh->get_leaf_count(), m_Scene.bvh->get_depth());
+
+				if (m_Scene.bvh8)
+					ImGui::Text("BVH8: %zu nodes (%s)", m_Scene.bvh8->nodes.size(), m_Scene.bvh8->is_vectorised() ? "AVX2" : "scalar");
+				else if (m_Scene.bvh4)
+					ImGui::Text("BVH4: %zu nodes (%s)", m_Scene.bvh4->nodes.size(), m_Scene.bvh4->is_vectorised() ? "SSE" : "scalar");
+				ImGui::Text("SAH cost: %.2f (%.2f at build)", m_Scene.bvh->get_cost(), m_Scene.bvh->get_build_cost());
+
+				const BVH::build_timings& timings = m_Scene.bvh->get_timings();
+				ImGui::Text("Build: %.3fms", timings.total_ms);
+				ImGui::Text("  primitives %.3fms, morton %.3fms, sort %.3fms", timings.primitives_ms, timings.morton_ms, timings.sort_ms);
+				ImGui::Text("  emit %.3fms, top levels %.3fms", timings.emit_ms, timings.top_ms);
 			}
 		}
 		ImGui::End();
@@ -68,17 +302,17 @@ public:
 
 					if (ImGui::CollapsingHeader(header_title.c_str()))
 					{
-						ImGui::ColorEdit3("Colour", glm::value_ptr(material->baseColour));
+						m_SceneEdited |= ImGui::ColorEdit3("Colour", glm::value_ptr(material->baseColour));
 
-						ImGui::DragFloat("Metallic", &material->metallic, 0.05f, 0.001f, 1.0f);
+						m_SceneEdited |= ImGui::DragFloat("Metallic", &material->metallic, 0.05f, 0.001f, 1.0f);
 
-						ImGui::DragFloat("Roughness", &material->roughness, 0.05f, 0.001f, 1.0f);
+						m_SceneEdited |= ImGui::DragFloat("Roughness", &material->roughness, 0.05f, 0.001f, 1.0f);
 
-						ImGui::DragFloat("Specular", &material->specular, 0.05f, 0.001f, 1.0f);
+						m_SceneEdited |= ImGui::DragFloat("Specular", &material->specular, 0.05f, 0.001f, 1.0f);
 
 						if (auto* emissive_material = dynamic_cast<emissive*>(material.get()))
 						{
-							ImGui::DragFloat("Intensity", &emissive_material->emissionStrength, 0.05f, 1.0f, 50.0f);
+							m_SceneEdited |= ImGui::DragFloat("Intensity", &emissive_material->emissionStrength, 0.05f, 1.0f, 50.0f);
 						}
 
 						ImGui::Separator();
@@ -95,11 +329,13 @@ public:
 					if (ImGui::Button("Non-Emissive"))
 					{
 						m_Scene.materials.emplace_back(std::make_unique<material>());
+						m_SceneEdited = true;
 						ImGui::CloseCurrentPopup();
 					}
 					if (ImGui::Button("Emissive"))
 					{
 						m_Scene.materials.emplace_back(std::make_unique<emissive>());
+						m_SceneEdited = true;
 						ImGui::CloseCurrentPopup();
 					}
 
@@ -122,12 +358,18 @@ public:
 					{
 						object* object = m_Scene.objects[i].get();
 
-						changed |= ImGui::DragFloat3("Position", glm::value_ptr(object->position), 0.05f);
-						changed |= ImGui::DragInt("Material", &object->material_index, 1.0f, 0, (int)m_Scene.materials.size() - 1);
+						bool moved = ImGui::DragFloat3("Position", glm::value_ptr(object->position), 0.05f);
+						// a new material can turn the object into a light or stop it being one
+						bool relit = ImGui::DragInt("Material", &object->material_index, 1.0f, 0, (int)m_Scene.materials.size() - 1);
 
 						if (auto* sphere_object = dynamic_cast<sphere*>(object))
 						{
-							changed |= ImGui::DragFloat("Radius", &sphere_object->radius, 0.05f);
+							moved |= ImGui::DragFloat("Radius", &sphere_object->radius, 0.05f);
+						}
+
+						if (moved || relit)
+						{
+							dirtyObjects.push_back(i);
 						}
 
 						ImGui::Separator();
@@ -145,16 +387,88 @@ public:
 
 			ImGui::EndChild();
 
+			// display meshes
+			ImGui::Text("Meshes");
+			ImGui::BeginChild("Meshes", ImVec2(0, 120), true);
+			{
+				for (size_t i = 0; i < m_Scene.meshes.size(); i++)
+				{
+					ImGui::PushID(i);
+
+					triangle_mesh& mesh = *m_Scene.meshes[i];
+					ImGui::Text("Mesh #%zu: %zu triangles", i + 1, mesh.triangle_count());
+
+					// hits read the mesh's material directly, so nothing needs rebuilding
+					if (ImGui::DragInt("Material", &mesh.material_index, 1.0f, 0, (int)m_Scene.materials.size() - 1))
+					{
+						m_SceneEdited = true;
+					}
+
+					// the mesh becomes a shared geometry with its own BVH and one instance in the same place
+					ImGui::SameLine();
+					if (ImGui::Button("Instance"))
+					{
+						InstanceMesh(i);
+						changed |= true;
+						ImGui::PopID();
+						break;
+					}
+
+					ImGui::PopID();
+				}
+			}
+			ImGui::EndChild();
+
+			// display instances
+			ImGui::Text("Instances");
+			ImGui::BeginChild("Instances", ImVec2(0, 200), true);
+			{
+				for (size_t i = 0; i < m_Scene.instances.size(); i++)
+				{
+					ImGui::PushID(i);
+
+					instance& placed = *m_Scene.instances[i];
+					std::string header_title = "Instance #" + std::to_string(i + 1) + " (" + std::to_string(placed.geometry->triangle_count()) + " triangles)";
+
+					if (ImGui::CollapsingHeader(header_title.c_str()))
+					{
+						// moving only refits the scene's BVH, the geometry's own tree is shared and never touched
+						if (ImGui::DragFloat3("Position", glm::value_ptr(placed.position), 0.05f))
+						{
+							dirtyObjects.push_back((int)(m_Scene.primitives.first_instance() + i));
+						}
+
+						if (ImGui::DragInt("Material", &placed.material_index, 1.0f, 0, (int)m_Scene.materials.size() - 1))
+						{
+							m_SceneEdited = true;
+						}
+
+						if (ImGui::Button("Copy"))
+						{
+							auto copy = std::make_unique<instance>(placed);
+							copy->position.x += 1.0f;
+							m_Scene.instances.push_back(std::move(copy));
+							changed |= true;
+						}
+
+						ImGui::Separator();
+					}
+
+					ImGui::PopID();
+				}
+			}
+			ImGui::EndChild();
+
 			// display background
 
 			ImGui::Text("Background");
 			ImGui::BeginChild("Background", ImVec2(0, 200), true);
 			{
-				ImGui::Checkbox("Enable Skybox", &m_Renderer.getSettings().skybox);
+				ImGui::Checkbox("Enable Skybox", &m_RenderSettings.skybox);
 
-				ImGui::BeginDisabled(m_Renderer.getSettings().skybox);
+				ImGui::BeginDisabled(m_RenderSettings.skybox);
 				{
-					ImGui::ColorEdit3("Background Colour", glm::value_ptr(m_Scene.backgroundColour));
+					m_SceneEdited |= ImGui::ColorEdit3("Background Colour", glm::value_ptr(m_Scene.backgroundColour));
 				}
 				ImGui::EndDisabled();
 			}
@@ -168,42 +482,142 @@ public:
 			m_ViewportWidth = ImGui::GetContentRegionAvail().x;
 			m_ViewportHeight = ImGui::GetContentRegionAvail().y;
 
-			auto image = m_Renderer.getFinalImage();
-			if (image)
+			if (m_Image)
 			{
-				ImGui::Image(image->GetDescriptorSet(), { (float)image->GetWidth(), (float)image->GetHeight() });
+				ImGui::Image(m_Image->GetDescriptorSet(), { (float)m_Image->GetWidth(), (float)m_Image->GetHeight() });
 			}
 		}
 		ImGui::End();
 		ImGui::PopStyleVar();
 
-		if (changed)
+		// new objects or settings need a full build, moving existing ones only refits the tree around them
+		if (changed || !m_Scene.bvh)
 		{
-			m_Scene.bvh = std::make_unique<BVH>(m_Scene.objects);
+			m_Scene.buildBVH(m_BVHSettings);
+			m_SceneEdited = true;
+		}
+		else if (!dirtyObjects.empty())
+		{
+			m_Scene.updateBVH(dirtyObjects);
+			m_SceneEdited = true;
 		}
 
 		Render();
 	}
 
+	// hands the render thread what changed and shows the newest frame it finished, without waiting for one.
+	// The scene is only copied over after an edit, the camera and settings go every frame
 	void Render() 
 	{
-		Timer timer; 
-
-		m_Renderer.onResize(m_ViewportWidth, m_ViewportHeight);
 		m_Camera.on_resize(m_ViewportWidth, m_ViewportHeight);
-		m_Renderer.render(m_Scene, m_Camera);
 
-		m_LastRenderTime = timer.ElapsedMillis();
+		if (m_SceneEdited)
+		{
+			m_RenderThread.submit_scene(m_Scene, m_MeshesChanged);
+			m_SceneEdited = false;
+			m_MeshesChanged = false;
+		}
+
+		m_RenderThread.submit_view(m_Camera, m_RenderSettings, m_ViewportWidth, m_ViewportHeight, m_Restart);
+		m_Restart = false;
+
+		if (m_RenderThread.acquire_frame())
+		{
+			UploadImage();
+		}
+	}
+
+	// replaces the scene with the file's, its stored BVH is used as it is instead of being rebuilt
+	void LoadScene()
+	{
+		Timer timer;
+
+		std::string error;
+		if (!scene_file::load(m_SceneFilePath, m_Scene, error))
+		{
+			m_SceneFileStatus = error;
+			return;
+		}
+
+		m_BVHSettings = m_Scene.bvh->get_settings();
+		m_SceneEdited = true;
+		m_MeshesChanged = true;
+
+		char status[64];
+		std::snprintf(status, sizeof(status), "Loaded %zu objects and %zu meshes in %.1fms", m_Scene.objects.size(), m_Scene.meshes.size(), timer.ElapsedMillis());
+		m_SceneFileStatus = status;
+	}
+
+	// replaces a mesh with one instance of it, so it can be copied without copying its triangles
+	void InstanceMesh(size_t meshIndex)
+	{
+		std::vector<std::unique_ptr<triangle_mesh>> meshes;
+		meshes.push_back(std::move(m_Scene.meshes[meshIndex]));
+		m_Scene.meshes.erase(m_Scene.meshes.begin() + meshIndex);
+
+		int materialIndex = meshes.back()->material_index;
+		auto geometry = std::make_shared<const instance_geometry>(std::vector<std::unique_ptr<object>>{}, std::move(meshes), m_BVHSettings);
+		m_Scene.instances.push_back(std::make_unique<instance>(std::move(geometry), glm::vec3(0.0f), materialIndex));
+		m_MeshesChanged = true;
+	}
+
+	// adds the mesh file at m_MeshFilePath with the default material, true if the BVH needs rebuilding
+	bool AddMesh()
+	{
+		auto mesh = std::make_unique<triangle_mesh>();
+		mesh_io::load_stats stats;
+		std::string error;
+
+		if (!mesh_io::load(m_MeshFilePath, *mesh, stats, error))
+		{
+			m_MeshFileStatus = error;
+			return false;
+		}
+
+		m_Scene.meshes.push_back(std::move(mesh));
+		m_MeshesChanged = true;
+
+		char status[128];
+		std::snprintf(status, sizeof(status), "Loaded %zu triangles in %.1fms (%.1fms, %.1fMB per million)",
+			stats.triangles, stats.load_ms, stats.ms_per_million_triangles(), stats.bytes_per_million_triangles() / (1024.0f * 1024.0f));
+		m_MeshFileStatus = status;
+		return true;
+	}
+
+	// copies the newest finished frame into the texture the viewport shows
+	void UploadImage()
+	{
+		const render_thread::frame& frame = m_RenderThread.get_frame();
+
+		if (!m_Image)
+		{
+			m_Image = std::make_shared<Image>(frame.width, frame.height, ImageFormat::RGBA);
+		}
+		else if (m_Image->GetWidth() != frame.width || m_Image->GetHeight() != frame.height)
+		{
+			m_Image->Resize(frame.width, frame.height);
+		}
+
+		m_Image->SetData(frame.rgba.data());
 	}
 
 private:
-	renderer m_Renderer;
+	render_thread m_RenderThread;
+	renderer::settings m_RenderSettings;
+	bool m_Restart = true; // the accumulated samples are stale
+	bool m_SceneEdited = true; // m_Scene differs from what the render thread traces
+	bool m_MeshesChanged = true; // and so do its meshes
+	std::shared_ptr<Image> m_Image;
 	camera m_Camera;
+	camera_controller m_CameraController;
 	scene m_Scene;
+	BVH::build_settings m_BVHSettings;
+	char m_SceneFilePath[256] = "scene.rtscene";
+	std::string m_SceneFileStatus;
+	char m_MeshFilePath[256] = "mesh.obj";
+	std::string m_MeshFileStatus;
 	uint32_t* m_ImageData = nullptr;
 	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
-
-	float m_LastRenderTime = 0.0f;
 };
 
 Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
@@ -211,8 +625,11 @@ Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
 	Walnut::ApplicationSpecification spec;
 	spec.Name = "Ray Tracing";
 
+	// a scene file given on the command line is loaded at startup
+	std::string sceneFile = argc > 1 ? argv[1] : "";
+
 	Walnut::Application* app = new Walnut::Application(spec);
-	app->PushLayer<ExampleLayer>();
+	app->PushLayer(std::make_shared<ExampleLayer>(sceneFile));
 	app->SetMenubarCallback([app]()
 	{
 		if (ImGui::BeginMenu("File"))
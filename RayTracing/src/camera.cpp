@@ -1,161 +0,0 @@
-#include "Camera.h"
-
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
-
-#include "Walnut/Input/Input.h"
-
-#include "Random.h"
-
-using namespace Walnut;
-
-camera::camera(float verticalFOV, float nearClip, float farClip)
-	: m_VerticalFOV(verticalFOV), m_NearClip(nearClip), m_FarClip(farClip)
-{
-	m_ForwardDirection = glm::vec3(0, 0, -1);
-	m_Position = glm::vec3(0, 0, 0);
-}
-
-bool camera::on_update(float ts)
-{
-	glm::vec2 mousePos = Input::GetMousePosition();
-	glm::vec2 delta = (mousePos - m_LastMousePosition) * 0.002f;
-	m_LastMousePosition = mousePos;
-
-	if (!Input::IsMouseButtonDown(MouseButton::Right))
-	{
-		Input::SetCursorMode(CursorMode::Normal);
-		return false;
-	}
-
-	Input::SetCursorMode(CursorMode::Locked);
-
-	bool moved = false;
-
-	constexpr glm::vec3 upDirection(0.0f, 1.0f, 0.0f);
-	glm::vec3 rightDirection = glm::cross(m_ForwardDirection, upDirection);
-
-	float speed = 5.0f;
-
-	// Movement
-	if (Input::IsKeyDown(KeyCode::W))
-	{
-		m_Position += m_ForwardDirection * speed * ts;
-		moved = true;
-	}
-	else if (Input::IsKeyDown(KeyCode::S))
-	{
-		m_Position -= m_ForwardDirection * speed * ts;
-		moved = true;
-	}
-	if (Input::IsKeyDown(KeyCode::A))
-	{
-		m_Position -= rightDirection * speed * ts;
-		moved = true;
-	}
-	else if (Input::IsKeyDown(KeyCode::D))
-	{
-		m_Position += rightDirection * speed * ts;
-		moved = true;
-	}
-	if (Input::IsKeyDown(KeyCode::Q))
-	{
-		m_Position -= upDirection * speed * ts;
-		moved = true;
-	}
-	else if (Input::IsKeyDown(KeyCode::E))
-	{
-		m_Position += upDirection * speed * ts;
-		moved = true;
-	}
-
-	// Rotation
-	if (delta.x != 0.0f || delta.y != 0.0f)
-	{
-		float pitchDelta = delta.y * get_rotation_speed();
-		float yawDelta = delta.x * get_rotation_speed();
-
-		glm::quat q = glm::normalize(glm::cross(
-			glm::angleAxis(-pitchDelta, rightDirection),
-			glm::angleAxis(-yawDelta, glm::vec3(0.f, 1.0f, 0.0f))));
-		m_ForwardDirection = glm::rotate(q, m_ForwardDirection);
-
-		moved = true;
-	}
-
-	if (moved)
-	{
-		recalculate_view();
-	}
-
-	return moved;
-}
-
-void camera::on_resize(uint32_t width, uint32_t height)
-{
-	if (width == m_ViewportWidth && height == m_ViewportHeight)
-		return;
-
-	m_ViewportWidth = width;
-	m_ViewportHeight = height;
-
-	recalculate_projection();
-}
-
-float camera::get_rotation_speed()
-{
-	return 0.3f;
-}
-
-void camera::recalculate_projection()
-{
-	m_Projection = glm::perspectiveFov(glm::radians(m_VerticalFOV), (float)m_ViewportWidth, (float)m_ViewportHeight, m_NearClip, m_FarClip);
-	m_InverseProjection = glm::inverse(m_Projection);
-}
-
-void camera::recalculate_view()
-{
-	m_View = glm::lookAt(m_Position, m_Position + m_ForwardDirection, glm::vec3(0, 1, 0));
-	m_InverseView = glm::inverse(m_View);
-}
-
-glm::vec3 camera::getRayDirection(uint32_t x, uint32_t y) const
-{
-	glm::vec2 jitter = { Random::getReal(0.0f, 1.0f) , Random::getReal(0.0f, 1.0f) };
-
-	// map to NDC space [0,1]
-	glm::vec2 coord = { (x + jitter.x) / m_ViewportWidth, (y + jitter.y) / m_ViewportHeight };
-
-	// map to screen space [-1,1]
-	coord.x = coord.x * 2.0f - 1.0f;
-	coord.y = 1.0f - coord.y * 2.0f;
-
-	glm::vec4 target = m_InverseProjection * glm::vec4(coord.x, coord.y, -1, 1);
-	return glm::vec3(m_InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0)); // World space
-}
-
-/*
-
-void camera::recalculate_ray_directions()
-{
-	m_RayDirections.resize(m_ViewportWidth * m_ViewportHeight);
-
-	for (uint32_t y = 0; y < m_ViewportHeight; y++)
-	{
-		for (uint32_t x = 0; x < m_ViewportWidth; x++)
-		{
-			// map to NDC space [0,1]
-			glm::vec2 coord = { (x + 0.5f) / m_ViewportWidth, (y + 0.5f) / m_ViewportHeight };
-
-			// map to screen space [-1,1]
-			coord.x = coord.x * 2.0f - 1.0f; 
-			coord.y = 1.0f - coord.y * 2.0f;
-
-			glm::vec4 target = m_InverseProjection * glm::vec4(coord.x, coord.y, -1, 1);
-			glm::vec3 rayDirection = glm::vec3(m_InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0)); // World space
-			m_RayDirections[x + y * m_ViewportWidth] = rayDirection;
-		}
-	}
-}
-*/
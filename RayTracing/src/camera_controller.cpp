@@ -0,0 +1,91 @@
+#include "camera_controller.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "Walnut/Input/Input.h"
+
+using namespace Walnut;
+
+bool camera_controller::on_update(camera& camera, float ts)
+{
+	glm::vec2 mousePos = Input::GetMousePosition();
+	glm::vec2 delta = (mousePos - m_LastMousePosition) * 0.002f;
+	m_LastMousePosition = mousePos;
+
+	if (!Input::IsMouseButtonDown(MouseButton::Right))
+	{
+		Input::SetCursorMode(CursorMode::Normal);
+		return false;
+	}
+
+	Input::SetCursorMode(CursorMode::Locked);
+
+	bool moved = false;
+
+	glm::vec3 position = camera.getPosition();
+	glm::vec3 forwardDirection = camera.get_direction();
+
+	constexpr glm::vec3 upDirection(0.0f, 1.0f, 0.0f);
+	glm::vec3 rightDirection = glm::cross(forwardDirection, upDirection);
+
+	float speed = 5.0f;
+
+	// Movement
+	if (Input::IsKeyDown(KeyCode::W))
+	{
+		position += forwardDirection * speed * ts;
+		moved = true;
+	}
+	else if (Input::IsKeyDown(KeyCode::S))
+	{
+		position -= forwardDirection * speed * ts;
+		moved = true;
+	}
+	if (Input::IsKeyDown(KeyCode::A))
+	{
+		position -= rightDirection * speed * ts;
+		moved = true;
+	}
+	else if (Input::IsKeyDown(KeyCode::D))
+	{
+		position += rightDirection * speed * ts;
+		moved = true;
+	}
+	if (Input::IsKeyDown(KeyCode::Q))
+	{
+		position -= upDirection * speed * ts;
+		moved = true;
+	}
+	else if (Input::IsKeyDown(KeyCode::E))
+	{
+		position += upDirection * speed * ts;
+		moved = true;
+	}
+
+	// Rotation
+	if (delta.x != 0.0f || delta.y != 0.0f)
+	{
+		float pitchDelta = delta.y * get_rotation_speed();
+		float yawDelta = delta.x * get_rotation_speed();
+
+		glm::quat q = glm::normalize(glm::cross(
+			glm::angleAxis(-pitchDelta, rightDirection),
+			glm::angleAxis(-yawDelta, glm::vec3(0.f, 1.0f, 0.0f))));
+		forwardDirection = glm::rotate(q, forwardDirection);
+
+		moved = true;
+	}
+
+	if (moved)
+	{
+		camera.set_view(position, forwardDirection);
+	}
+
+	return moved;
+}
+
+float camera_controller::get_rotation_speed()
+{
+	return 0.3f;
+}
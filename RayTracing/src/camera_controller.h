@@ -0,0 +1,16 @@
+#pragma once
+
+#include "camera.h"
+
+// Flies a camera with Walnut's input while the right mouse button is held: WASD and QE move it,
+// the mouse turns it. Kept out of the core so the renderer builds without a window.
+class camera_controller
+{
+public:
+	// true if the camera moved
+	bool on_update(camera& camera, float ts);
+
+	float get_rotation_speed();
+private:
+	glm::vec2 m_LastMousePosition{ 0.0f, 0.0f };
+};
@@ -0,0 +1,42 @@
+project "RayTracingBench"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   staticruntime "off"
+
+   files { "src/**.h", "src/**.cpp" }
+
+   includedirs
+   {
+      "../Walnut/vendor/glm",
+      "../RayTracingCore/src",
+   }
+
+   links
+   {
+      "RayTracingCore"
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+
+   -- std::execution::par is backed by TBB in libstdc++
+   filter "system:linux"
+      links { "tbb", "pthread" }
+
+   filter "configurations:Debug"
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
@@ -0,0 +1,468 @@
+#include "renderer.h"
+#include "camera.h"
+#include "scene.h"
+#include "scene_generator.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures BVH builds, ray throughput, material evaluation and whole frames on the procedural scenes
+// and writes the results as JSON, so runs of different versions can be compared.
+namespace
+{
+	struct bench_options
+	{
+		std::vector<size_t> sizes{ 10, 100, 1000, 10000, 100000, 1000000 };
+		uint32_t width{ 256 };
+		uint32_t height{ 256 };
+		int frames{ 4 };
+		float minSeconds{ 0.25f }; // each throughput test repeats until it has run at least this long
+		std::string output{};
+	};
+
+	// bumped whenever a key is added, renamed or measured differently
+	constexpr int RESULT_FORMAT{ 3 };
+
+	using clock = std::chrono::steady_clock;
+
+	double secondsSince(clock::time_point start)
+	{
+		return std::chrono::duration<double>(clock::now() - start).count();
+	}
+
+	// runs work until minSeconds have passed, returns items processed per second
+	template <typename Work>
+	double throughput(float minSeconds, size_t itemsPerRun, Work work)
+	{
+		size_t runs = 0;
+		clock::time_point start = clock::now();
+		double elapsed = 0.0;
+
+		do
+		{
+			work();
+			runs++;
+			elapsed = secondsSince(start);
+		} while (elapsed < minSeconds);
+
+		return runs * itemsPerRun / elapsed;
+	}
+
+	// fastest of a few builds, a single one for scenes that take longer than a second
+	double buildMilliseconds(scene& scene, const BVH::build_settings& settings)
+	{
+		double best = 0.0;
+		for (int run = 0; run < 3; run++)
+		{
+			clock::time_point start = clock::now();
+			scene.buildBVH(settings);
+			double ms = 1000.0 * secondsSince(start);
+
+			best = run == 0 ? ms : std::min(best, ms);
+			if (ms > 1000.0)
+				break;
+		}
+		return best;
+	}
+
+	struct scene_case
+	{
+		std::string name;
+		size_t objects;
+	};
+
+	class json_writer
+	{
+	public:
+		std::string text;
+
+		void begin_object(const char* key = nullptr) { open(key, '{'); }
+		void end_object() { close('}'); }
+		void begin_array(const char* key = nullptr) { open(key, '['); }
+		void end_array() { close(']'); }
+
+		void value(const char* key, double number)
+		{
+			char buffer[64];
+			std::snprintf(buffer, sizeof(buffer), "%.6g", number);
+			field(key);
+			text += buffer;
+		}
+
+		void value(const char* key, const std::string& string)
+		{
+			field(key);
+			text += '"' + string + '"';
+		}
+
+	private:
+		std::vector<bool> m_first{};
+
+		void field(const char* key)
+		{
+			if (!m_first.empty())
+			{
+				if (!m_first.back())
+					text += ',';
+				m_first.back() = false;
+				text += '\n' + std::string(2 * m_first.size(), ' ');
+			}
+
+			if (key)
+				text += '"' + std::string(key) + "\": ";
+		}
+
+		void open(const char* key, char bracket)
+		{
+			field(key);
+			text += bracket;
+			m_first.push_back(true);
+		}
+
+		void close(char bracket)
+		{
+			m_first.pop_back();
+			text += '\n' + std::string(2 * m_first.size(), ' ') + bracket;
+		}
+	};
+
+	const char* simdName(simd::level level)
+	{
+		switch (level)
+		{
+		case simd::level::avx2: return "avx2";
+		case simd::level::sse: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	void benchmarkMaterials(const bench_options& options, json_writer& json)
+	{
+		material diffuse;
+		diffuse.metallic = 0.0f;
+		material metal;
+		metal.metallic = 1.0f;
+		metal.roughness = 0.2f;
+
+		// a fixed set of view directions over the upper hemisphere of +z
+		constexpr size_t COUNT{ 4096 };
+		std::vector<ray> rays(COUNT);
+		std::vector<hit_info> hits(COUNT);
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			sampler rng(0, (uint32_t)i, 0);
+			glm::vec3 view = rng.on_unit_sphere();
+			view.z = std::abs(view.z) + 0.01f;
+
+			rays[i] = { glm::vec3(0.0f), -glm::normalize(view) };
+			hits[i].worldNormal = { 0.0f, 0.0f, 1.0f };
+			hits[i].hitDistance = 1.0f;
+		}
+
+		json.begin_object("materials");
+		for (const material* evaluated : { &diffuse, &metal })
+		{
+			float sum = 0.0f;
+
+			double scatters = throughput(options.minSeconds, COUNT, [&]()
+			{
+				for (size_t i = 0; i < COUNT; i++)
+				{
+					sampler rng(1, (uint32_t)i, 0);
+					ray scattered;
+					float pdf;
+					if (evaluated->scatter(rays[i], scattered, hits[i], pdf, rng))
+						sum += pdf;
+				}
+			});
+
+			double brdfs = throughput(options.minSeconds, COUNT, [&]()
+			{
+				for (size_t i = 0; i < COUNT; i++)
+				{
+					glm::vec3 light = -rays[(i + 1) % COUNT].direction;
+					sum += evaluated->brdf(-rays[i].direction, light, hits[i].worldNormal).r;
+				}
+			});
+
+			json.begin_object(evaluated == &diffuse ? "diffuse" : "metal");
+			json.value("scatter_per_second", scatters);
+			json.value("brdf_per_second", brdfs);
+			json.value("checksum", sum);
+			json.end_object();
+		}
+		json.end_object();
+	}
+
+	void benchmarkScene(const bench_options& options, const scene_case& sceneCase, json_writer& json)
+	{
+		scene scene;
+		camera camera(45.0f, 0.1f, 100.0f);
+		camera.on_resize(options.width, options.height);
+		scene_generator::generate(sceneCase.name, sceneCase.objects, 0, scene, camera);
+
+		size_t triangles = 0;
+		for (const auto& mesh : scene.meshes)
+		{
+			triangles += mesh->triangle_count();
+		}
+
+		size_t instancedTriangles = 0;
+		for (const auto& placed : scene.instances)
+		{
+			instancedTriangles += placed->geometry->triangle_count();
+		}
+
+		std::fprintf(stderr, "%s, %zu objects, %zu triangles, %zu instances\n", sceneCase.name.c_str(), scene.objects.size(), triangles,
+			scene.instances.size());
+
+		json.begin_object();
+		json.value("scene", sceneCase.name);
+		json.value("objects", (double)scene.objects.size());
+		json.value("triangles", (double)triangles);
+		json.value("instances", (double)scene.instances.size());
+		json.value("instanced_triangles", (double)instancedTriangles);
+
+		// builds with every strategy, the one traced is built last
+		const std::pair<const char*, BVH::build_strategy> strategies[] = {
+			{ "octree", BVH::build_strategy::octree },
+			{ "lbvh", BVH::build_strategy::lbvh },
+			{ "sah", BVH::build_strategy::sah },
+		};
+
+		json.begin_object("build_ms");
+		BVH::build_settings settings;
+		for (const auto& [name, strategy] : strategies)
+		{
+			settings.strategy = strategy;
+			json.value(name, buildMilliseconds(scene, settings));
+		}
+		json.end_object();
+
+		json.value("bvh_nodes", (double)scene.bvh->nodes.size());
+		json.value("bvh_sah_cost", scene.bvh->get_cost());
+
+		// one jittered camera ray per pixel, in 4x4 blocks so the packet path gets whole packets
+		std::vector<ray> primary;
+		primary.reserve((size_t)options.width * options.height);
+		for (uint32_t blockY = 0; blockY < options.height; blockY += 4)
+		{
+			for (uint32_t blockX = 0; blockX < options.width; blockX += 4)
+			{
+				for (uint32_t y = blockY; y < std::min(blockY + 4, options.height); y++)
+				{
+					for (uint32_t x = blockX; x < std::min(blockX + 4, options.width); x++)
+					{
+						sampler rng(0, y * options.width + x, 0);
+						primary.push_back({ camera.getPosition(), camera.getRayDirection(x, y, rng) });
+					}
+				}
+			}
+		}
+
+		// secondary rays leave the primary hits in random directions of the normal's hemisphere,
+		// missed pixels send theirs from the camera
+		std::vector<ray> incoherent(primary.size());
+		size_t primaryHits = 0;
+		for (size_t i = 0; i < primary.size(); i++)
+		{
+			hit_info hit = scene.traceRay(primary[i]);
+			sampler rng(0, (uint32_t)i, 1);
+			glm::vec3 direction = rng.on_unit_sphere();
+
+			if (hit.didHit())
+			{
+				if (glm::dot(direction, hit.worldNormal) < 0.0f)
+					direction = -direction;
+				incoherent[i] = { hit.worldPosition + 0.001f * hit.worldNormal, direction };
+				primaryHits++;
+			}
+			else
+			{
+				incoherent[i] = { primary[i].origin, direction };
+			}
+		}
+
+		double checksum = 0.0;
+		auto traceAll = [&](const std::vector<ray>& rays)
+		{
+			for (const ray& traced : rays)
+				checksum += scene.traceRay(traced).hitDistance;
+		};
+
+		json.value("primary_hit_fraction", (double)primaryHits / primary.size());
+
+		json.begin_object("rays_per_second");
+		json.value("primary", throughput(options.minSeconds, primary.size(), [&]() { traceAll(primary); }));
+		json.value("primary_packets", throughput(options.minSeconds, primary.size(), [&]()
+		{
+			std::array<hit_info, ray_packet::SIZE> hits;
+			for (size_t first = 0; first < primary.size(); first += ray_packet::SIZE)
+			{
+				int count = (int)std::min<size_t>(ray_packet::SIZE, primary.size() - first);
+				scene.traceRayPacket(primary.data() + first, count, hits.data());
+				checksum += hits[0].hitDistance;
+			}
+		}));
+		json.value("incoherent", throughput(options.minSeconds, incoherent.size(), [&]() { traceAll(incoherent); }));
+		json.value("incoherent_occluded", throughput(options.minSeconds, incoherent.size(), [&]()
+		{
+			for (const ray& traced : incoherent)
+				checksum += scene.occluded(traced, FLT_MAX);
+		}));
+		json.end_object();
+
+		// whole frames on every thread, one sample per pixel each
+		renderer renderer;
+		renderer.getSettings().accumulate = true;
+		renderer.getSettings().skybox = true;
+		renderer.onResize(options.width, options.height);
+		renderer.render(scene, camera); // warms up the thread pool
+
+		clock::time_point start = clock::now();
+		for (int frame = 0; frame < options.frames; frame++)
+		{
+			renderer.render(scene, camera);
+		}
+		double frameSeconds = secondsSince(start);
+
+		json.value("samples_per_second", (double)options.width * options.height * options.frames / frameSeconds);
+		json.value("ms_per_frame", 1000.0 * frameSeconds / options.frames);
+		json.value("checksum", checksum);
+
+		json.end_object();
+	}
+
+	std::vector<size_t> parseSizes(const std::string& list)
+	{
+		std::vector<size_t> sizes;
+		size_t start = 0;
+		while (start < list.size())
+		{
+			size_t comma = list.find(',', start);
+			if (comma == std::string::npos)
+				comma = list.size();
+
+			sizes.push_back((size_t)std::atoll(list.substr(start, comma - start).c_str()));
+			start = comma + 1;
+		}
+		return sizes;
+	}
+
+	void printUsage()
+	{
+		std::printf(
+			"usage: RayTracingBench [options]\n"
+			"  --sizes <n,n,...>      object counts of the random and clustered scenes, triangle\n"
+			"                         counts of the tori scene and instance counts of the instances\n"
+			"                         scene (10 to 1000000)\n"
+			"  --width <n>            image width for ray and frame tests (256)\n"
+			"  --height <n>           image height (256)\n"
+			"  --frames <n>           frames timed per scene (4)\n"
+			"  --min-time <seconds>   minimum time per throughput test (0.25)\n"
+			"  --output <file>        write the JSON there instead of standard output\n");
+	}
+
+	bool parseOptions(int argc, char** argv, bench_options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--help" || arg == "-h" || i + 1 >= argc)
+				return false;
+			else if (arg == "--sizes")
+				options.sizes = parseSizes(argv[++i]);
+			else if (arg == "--width")
+				options.width = (uint32_t)std::atoi(argv[++i]);
+			else if (arg == "--height")
+				options.height = (uint32_t)std::atoi(argv[++i]);
+			else if (arg == "--frames")
+				options.frames = std::atoi(argv[++i]);
+			else if (arg == "--min-time")
+				options.minSeconds = (float)std::atof(argv[++i]);
+			else if (arg == "--output")
+				options.output = argv[++i];
+			else
+			{
+				std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+				return false;
+			}
+		}
+
+		return options.width > 0 && options.height > 0 && options.frames > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::vector<scene_case> cases;
+	for (size_t size : options.sizes)
+	{
+		cases.push_back({ "random", size });
+	}
+	for (size_t size : options.sizes)
+	{
+		cases.push_back({ "clustered", size });
+	}
+	cases.push_back({ "cornell", 0 });
+	for (size_t size : options.sizes)
+	{
+		cases.push_back({ "tori", size });
+	}
+	for (size_t size : options.sizes)
+	{
+		cases.push_back({ "instances", size });
+	}
+
+	json_writer json;
+	json.begin_object();
+	json.value("format", RESULT_FORMAT);
+	json.value("simd", simdName(simd::get()));
+	json.value("hardware_threads", std::thread::hardware_concurrency());
+	json.value("width", options.width);
+	json.value("height", options.height);
+
+	benchmarkMaterials(options, json);
+
+	json.begin_array("scenes");
+	for (const scene_case& sceneCase : cases)
+	{
+		benchmarkScene(options, sceneCase, json);
+	}
+	json.end_array();
+
+	json.end_object();
+	json.text += '\n';
+
+	if (options.output.empty())
+	{
+		std::fputs(json.text.c_str(), stdout);
+		return 0;
+	}
+
+	FILE* file = std::fopen(options.output.c_str(), "w");
+	if (!file)
+	{
+		std::fprintf(stderr, "could not write %s\n", options.output.c_str());
+		return 1;
+	}
+
+	std::fputs(json.text.c_str(), file);
+	std::fclose(file);
+	return 0;
+}
@@ -0,0 +1,423 @@
+#include "renderer.h"
+#include "camera.h"
+#include "scene.h"
+#include "image_io.h"
+#include "scene_generator.h"
+#include "scene_file.h"
+#include "mesh_io.h"
+
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct cli_options
+	{
+		uint32_t width{ 1280 };
+		uint32_t height{ 720 };
+		int samples{ -1 };		// -1 until given, then the frame count to stop at
+		float seconds{ 0.0f };	// time budget, 0 for none
+		std::string output{ "render.png" };
+		std::string statsOutput{};
+		std::string sceneName{ "showcase" };
+		std::string loadScene{};
+		std::string saveScene{};
+		std::string validateScene{};
+		std::vector<std::string> meshes{};
+		size_t objects{ 1000 };
+		bool denoise{ false }; // the finished image only, with settings.denoising
+		BVH::build_strategy bvhStrategy{ BVH::build_strategy::sah };
+		renderer::settings settings{};
+	};
+
+	void printUsage()
+	{
+		std::printf(
+			"usage: RayTracingCLI [options]\n"
+			"  --width <n>            image width (1280)\n"
+			"  --height <n>           image height (720)\n"
+			"  --samples <n>          samples per pixel to stop at (64 without --time)\n"
+			"  --time <seconds>       stop once this much time has been spent\n"
+			"  --output <file>        .png, or .pfm for linear float output (render.png)\n"
+			"  --scene <name>         showcase, random, clustered, cornell, tori or instances (showcase)\n"
+			"  --objects <n>          spheres in the random, clustered and cornell scenes,\n"
+			"                         triangles in tori and copies of the torus in instances (1000)\n"
+			"  --mesh <file>          add an .obj or .ply mesh to the generated scene and point the\n"
+			"                         camera at it, repeatable\n"
+			"  --load-scene <file>    render a scene file instead of a generated scene\n"
+			"  --save-scene <file>    write the scene and its BVH as a scene file\n"
+			"  --validate-scene <file> check a scene file and exit\n"
+			"  --bvh <strategy>       octree, sah or lbvh (sah)\n"
+			"  --seed <n>             random seed (0)\n"
+			"  --depth <n>            maximum bounces (64)\n"
+			"  --threads <n>          render threads, 0 for all (0)\n"
+			"  --noise <threshold>    stop sampling pixels below this relative error (0, off)\n"
+			"  --denoise <n>          filter the finished image with n a-trous passes (off)\n"
+			"  --stats <file>         write ray statistics of the whole render as JSON\n"
+			"  --heatmap <cost>       draw the nodes or primitives each camera ray tested instead of\n"
+			"                         shading, and print their histogram (needs RT_RAY_STATS)\n"
+			"  --heatmap-max <n>      cost at the hot end of the heatmap (64)\n"
+			"  --wavefront            use the wavefront integrator\n"
+			"  --no-nee               don't sample lights directly\n");
+	}
+
+	bool parseOptions(int argc, char** argv, cli_options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "--help" || arg == "-h")
+				return false;
+			else if (arg == "--wavefront")
+				options.settings.integrator = renderer::integrator_mode::wavefront;
+			else if (arg == "--no-nee")
+				options.settings.nextEventEstimation = false;
+			else if (!hasValue)
+			{
+				std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+				return false;
+			}
+			else if (arg == "--width")
+				options.width = (uint32_t)std::atoi(argv[++i]);
+			else if (arg == "--height")
+				options.height = (uint32_t)std::atoi(argv[++i]);
+			else if (arg == "--samples")
+				options.samples = std::atoi(argv[++i]);
+			else if (arg == "--time")
+				options.seconds = (float)std::atof(argv[++i]);
+			else if (arg == "--output")
+				options.output = argv[++i];
+			else if (arg == "--stats")
+				options.statsOutput = argv[++i];
+			else if (arg == "--scene")
+				options.sceneName = argv[++i];
+			else if (arg == "--objects")
+				options.objects = (size_t)std::atoll(argv[++i]);
+			else if (arg == "--load-scene")
+				options.loadScene = argv[++i];
+			else if (arg == "--save-scene")
+				options.saveScene = argv[++i];
+			else if (arg == "--validate-scene")
+				options.validateScene = argv[++i];
+			else if (arg == "--mesh")
+				options.meshes.push_back(argv[++i]);
+			else if (arg == "--bvh")
+			{
+				std::string strategy = argv[++i];
+				if (strategy == "octree")
+					options.bvhStrategy = BVH::build_strategy::octree;
+				else if (strategy == "sah")
+					options.bvhStrategy = BVH::build_strategy::sah;
+				else if (strategy == "lbvh")
+					options.bvhStrategy = BVH::build_strategy::lbvh;
+				else
+				{
+					std::fprintf(stderr, "unknown BVH strategy %s\n", strategy.c_str());
+					return false;
+				}
+			}
+			else if (arg == "--heatmap")
+			{
+				std::string cost = argv[++i];
+				if (cost == "nodes")
+					options.settings.debugView = renderer::debug_view::traversal_nodes;
+				else if (cost == "primitives")
+					options.settings.debugView = renderer::debug_view::traversal_primitives;
+				else
+				{
+					std::fprintf(stderr, "unknown heatmap cost %s\n", cost.c_str());
+					return false;
+				}
+			}
+			else if (arg == "--heatmap-max")
+				options.settings.heatmapMax = std::atoi(argv[++i]);
+			else if (arg == "--seed")
+				options.settings.seed = std::atoi(argv[++i]);
+			else if (arg == "--depth")
+				options.settings.rayDepth = std::atoi(argv[++i]);
+			else if (arg == "--threads")
+				options.settings.scheduler.threadCount = std::atoi(argv[++i]);
+			else if (arg == "--noise")
+				options.settings.noiseThreshold = (float)std::atof(argv[++i]);
+			else if (arg == "--denoise")
+			{
+				options.denoise = true;
+				options.settings.denoising.iterations = std::atoi(argv[++i]);
+			}
+			else
+			{
+				std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+				return false;
+			}
+		}
+
+		if (options.width == 0 || options.height == 0)
+		{
+			std::fprintf(stderr, "image size must be at least 1x1\n");
+			return false;
+		}
+
+		if (options.settings.debugView != renderer::debug_view::none)
+		{
+			if (!ray_stats::ENABLED)
+			{
+				std::fprintf(stderr, "the heatmap counts with the ray statistics, build with RT_RAY_STATS\n");
+				return false;
+			}
+
+			// every frame of a heatmap is the same, one is enough
+			options.samples = 1;
+			options.seconds = 0.0f;
+		}
+
+		if (options.samples < 0)
+			options.samples = options.seconds > 0.0f ? 0 : 64;
+
+		return true;
+	}
+
+	void frameBounds(const glm::vec3& min, const glm::vec3& max, camera& camera)
+	{
+		glm::vec3 centre = 0.5f * (min + max);
+		float radius = 0.5f * glm::length(max - min);
+		camera.set_view(centre + glm::vec3(0.0f, 0.0f, 2.5f * radius), { 0.0f, 0.0f, -1.0f });
+	}
+
+	// scene files don't store a view, so look at the whole scene from in front of it.
+	// The bounds come from the primitives, a leaf root node only carries the slanted slabs
+	void frameScene(const scene& scene, camera& camera)
+	{
+		if (scene.primitives.size() == 0)
+			return;
+
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+		for (uint32_t p = 0; p < scene.primitives.size(); p++)
+		{
+			extent aabb = scene.primitives.get_extent(p, { 0,1,2 });
+			min = glm::min(min, glm::vec3(aabb.slabs[0].d_near, aabb.slabs[1].d_near, aabb.slabs[2].d_near));
+			max = glm::max(max, glm::vec3(aabb.slabs[0].d_far, aabb.slabs[1].d_far, aabb.slabs[2].d_far));
+		}
+
+		frameBounds(min, max, camera);
+	}
+
+	// loads each mesh with a plain grey material of its own and frames all of them
+	bool addMeshes(const std::vector<std::string>& paths, scene& scene, camera& camera)
+	{
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+
+		for (const std::string& path : paths)
+		{
+			auto mesh = std::make_unique<triangle_mesh>();
+			mesh_io::load_stats stats;
+			std::string error;
+			if (!mesh_io::load(path, *mesh, stats, error))
+			{
+				std::fprintf(stderr, "%s\n", error.c_str());
+				return false;
+			}
+
+			std::printf("loaded %s: %zu triangles, %zu vertices in %.1f ms from %zu chunks, %.1f ms and %.1f MB per million triangles\n",
+				path.c_str(), stats.triangles, stats.vertices, stats.load_ms, stats.chunks,
+				stats.ms_per_million_triangles(), stats.bytes_per_million_triangles() / (1024.0f * 1024.0f));
+
+			for (const glm::vec3& position : mesh->positions)
+			{
+				min = glm::min(min, position);
+				max = glm::max(max, position);
+			}
+
+			auto grey = std::make_unique<material>();
+			grey->baseColour = glm::vec3(0.7f);
+			scene.materials.push_back(std::move(grey));
+			mesh->material_index = (int)scene.materials.size() - 1;
+			scene.meshes.push_back(std::move(mesh));
+		}
+
+		frameBounds(min, max, camera);
+		return true;
+	}
+
+	int validateScene(const std::string& path)
+	{
+		mapped_file file;
+		if (!file.open(path))
+		{
+			std::fprintf(stderr, "could not open %s\n", path.c_str());
+			return 1;
+		}
+
+		scene_file::view view;
+		std::string error;
+		if (!scene_file::open_view(file.data(), file.size(), view, error))
+		{
+			std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+			return 1;
+		}
+
+		std::printf("%s: version %u, %zu materials, %zu spheres, %zu meshes with %zu triangles, %zu BVH nodes\n",
+			path.c_str(), view.header->version, view.materialCount, view.sphereCount, view.meshCount, view.triangleCount, view.nodeCount);
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	cli_options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (!options.validateScene.empty())
+		return validateScene(options.validateScene);
+
+	scene scene;
+	camera camera(45.0f, 0.1f, 100.0f);
+	camera.on_resize(options.width, options.height);
+
+	using clock = std::chrono::steady_clock;
+	clock::time_point setupStart = clock::now();
+
+	if (!options.loadScene.empty())
+	{
+		std::string error;
+		if (!scene_file::load(options.loadScene, scene, error))
+		{
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+
+		frameScene(scene, camera);
+		std::printf("loaded %zu objects and %zu triangles in %.1f ms\n", scene.objects.size(), scene.primitives.size() - scene.objects.size(),
+			std::chrono::duration<float, std::milli>(clock::now() - setupStart).count());
+	}
+	else
+	{
+		if (!scene_generator::generate(options.sceneName, options.objects, (uint32_t)options.settings.seed, scene, camera))
+		{
+			std::fprintf(stderr, "unknown scene %s\n", options.sceneName.c_str());
+			printUsage();
+			return 1;
+		}
+
+		if (!options.meshes.empty() && !addMeshes(options.meshes, scene, camera))
+			return 1;
+
+		BVH::build_settings bvhSettings;
+		bvhSettings.strategy = options.bvhStrategy;
+		scene.buildBVH(bvhSettings);
+
+		// instances only hold a transform, the triangles they stand for are stored once per geometry
+		size_t instancedTriangles = 0;
+		for (const auto& placed : scene.instances)
+		{
+			instancedTriangles += placed->geometry->triangle_count();
+		}
+
+		std::printf("built %zu objects, %zu triangles and %zu instances of %zu triangles in %.1f ms\n", scene.objects.size(),
+			scene.primitives.first_instance() - scene.objects.size(), scene.instances.size(), instancedTriangles,
+			std::chrono::duration<float, std::milli>(clock::now() - setupStart).count());
+	}
+
+	if (!options.saveScene.empty())
+	{
+		if (!scene_file::write(scene, options.saveScene))
+		{
+			std::fprintf(stderr, scene.instances.empty() ? "could not write %s\n" : "could not write %s, scene files can't hold instances yet\n",
+				options.saveScene.c_str());
+			return 1;
+		}
+
+		std::printf("wrote %s\n", options.saveScene.c_str());
+	}
+
+	renderer renderer;
+	renderer.getSettings() = options.settings;
+	renderer.getSettings().accumulate = true;
+	renderer.getSettings().skybox = true;
+	renderer.onResize(options.width, options.height);
+
+	clock::time_point start = clock::now();
+
+	// one sample per pixel per frame, until the sample count or the time budget runs out
+	int frames = 0;
+	float elapsed = 0.0f;
+	ray_stats stats;
+	while (true)
+	{
+		renderer.render(scene, camera);
+		frames++;
+		stats.merge(renderer.getRayStats());
+
+		elapsed = std::chrono::duration<float>(clock::now() - start).count();
+
+		if (options.samples > 0 && frames >= options.samples)
+			break;
+		if (options.seconds > 0.0f && elapsed >= options.seconds)
+			break;
+		if (options.settings.noiseThreshold > 0.0f && renderer.getActivePixelCount() == 0)
+			break;
+	}
+
+	std::printf("%d samples per pixel in %.2fs (%.1f ms per frame)\n", frames, elapsed, 1000.0f * elapsed / frames);
+
+	if (options.denoise && options.settings.debugView == renderer::debug_view::none)
+	{
+		renderer.denoise();
+		std::printf("denoised in %.1f ms\n", renderer.getDenoiseMs());
+	}
+
+	if (!image_io::write(renderer.getFramebuffer(), options.output))
+	{
+		std::fprintf(stderr, "could not write %s\n", options.output.c_str());
+		return 1;
+	}
+
+	std::printf("wrote %s\n", options.output.c_str());
+
+	if (options.settings.debugView != renderer::debug_view::none)
+	{
+		const renderer::traversal_histogram& histogram = renderer.getTraversalHistogram();
+		float pixels = (float)options.width * options.height;
+
+		std::printf("%s per camera ray: %.2f mean, %u max\n",
+			options.settings.debugView == renderer::debug_view::traversal_nodes ? "nodes" : "primitives", histogram.mean, histogram.max);
+
+		for (int bin = 0; bin < renderer::traversal_histogram::BIN_COUNT; bin++)
+		{
+			if (histogram.bins[bin] == 0)
+				continue;
+
+			bool last = bin == renderer::traversal_histogram::BIN_COUNT - 1;
+			std::printf("  %6.1f%s %6.2f%%\n", bin * histogram.binWidth, last ? "+" : " ", 100.0f * histogram.bins[bin] / pixels);
+		}
+	}
+
+	if (!options.statsOutput.empty())
+	{
+		if (!ray_stats::ENABLED)
+			std::fprintf(stderr, "ray statistics are compiled out, build with RT_RAY_STATS\n");
+
+		FILE* file = std::fopen(options.statsOutput.c_str(), "w");
+		if (!file)
+		{
+			std::fprintf(stderr, "could not write %s\n", options.statsOutput.c_str());
+			return 1;
+		}
+
+		std::fprintf(file, "{\"frames\": %d, \"seconds\": %.3f, \"stats\": %s}\n", frames, elapsed, stats.to_json().c_str());
+		std::fclose(file);
+	}
+
+	return 0;
+}
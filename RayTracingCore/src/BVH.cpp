@@ -0,0 +1,999 @@
+#include "BVH.h"
+#include "sphere_set.h"
+#include "ray_stats.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	float elapsed_ms(clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(clock::now() - start).count();
+	}
+
+	// spreads the low 21 bits of v so there are two zero bits between each of them
+	uint64_t expand_bits(uint64_t v)
+	{
+		v &= 0x1fffff;
+		v = (v | v << 32) & 0x1f00000000ffff;
+		v = (v | v << 16) & 0x1f0000ff0000ff;
+		v = (v | v << 8) & 0x100f00f00f00f00f;
+		v = (v | v << 4) & 0x10c30c30c30c30c3;
+		v = (v | v << 2) & 0x1249249249249249;
+		return v;
+	}
+
+	uint64_t morton_code(const glm::vec3& unit_position)
+	{
+		glm::vec3 p = glm::clamp(unit_position * 2097151.0f, 0.0f, 2097151.0f);
+		return expand_bits((uint64_t)p.x) << 2 | expand_bits((uint64_t)p.y) << 1 | expand_bits((uint64_t)p.z);
+	}
+
+	// splits a sorted range where its highest differing bit flips, or in half if every code is equal
+	size_t find_split(const std::vector<uint64_t>& codes, size_t begin, size_t end)
+	{
+		uint64_t difference = codes[begin] ^ codes[end - 1];
+		if (difference == 0)
+			return begin + (end - begin) / 2;
+
+		uint64_t mask = 1ull << 63;
+		while (!(difference & mask))
+		{
+			mask >>= 1;
+		}
+
+		return std::partition_point(codes.begin() + begin, codes.begin() + end, [mask](uint64_t code) { return !(code & mask); }) - codes.begin();
+	}
+
+	float area(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+}
+
+BVH::BVH(const primitive_list& objects)
+	: BVH(objects, build_settings{})
+{
+}
+
+BVH::BVH(const primitive_list& objects, const build_settings& settings)
+	: m_settings(settings)
+{
+	m_settings.max_leaf_size = std::max(1, m_settings.max_leaf_size);
+	m_settings.max_depth = std::clamp(m_settings.max_depth, 0, m_settings.strategy == build_strategy::octree ? MAX_OCTREE_DEPTH : MAX_DEPTH);
+	m_settings.sah_bins = std::clamp(m_settings.sah_bins, 2, MAX_SAH_BINS);
+
+	auto build_start = clock::now();
+
+	nodes.reserve(2 * objects.size() + 1);
+	object_indices.reserve(objects.size());
+
+	nodes.emplace_back();
+
+	if (m_settings.strategy == build_strategy::lbvh)
+	{
+		build_lbvh(objects);
+
+		m_timings.total_ms = elapsed_ms(build_start);
+		link_nodes();
+		compute_cost(objects);
+		return;
+	}
+
+	// build(objects)
+	extent scene_aabb{};
+	std::vector<int> all_indices(objects.size());
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		scene_aabb.expand(objects.get_extent(i, { 0,1,2 }));
+		all_indices[i] = i;
+	}
+
+	nodes[0].bounds = scene_aabb;
+
+	switch (m_settings.strategy)
+	{
+	case build_strategy::octree:
+		build_tree(0, objects, all_indices, 0);
+		break;
+	case build_strategy::sah:
+	{
+		auto start = clock::now();
+		std::vector<build_primitive> primitives = compute_primitives(objects);
+		m_timings.primitives_ms = elapsed_ms(start);
+
+		start = clock::now();
+		build_sah(0, objects, primitives, all_indices, 0, all_indices.size(), 0);
+		m_timings.emit_ms = elapsed_ms(start);
+		break;
+	}
+	default:
+		break;
+	}
+
+	m_timings.total_ms = elapsed_ms(build_start);
+
+	link_nodes();
+	compute_cost(objects);
+}
+
+BVH::BVH(std::vector<BVHNode> prebuilt_nodes, std::vector<int> prebuilt_indices, const build_settings& settings, float build_cost)
+	: nodes(std::move(prebuilt_nodes)), object_indices(std::move(prebuilt_indices)), m_settings(settings), m_buildCost(build_cost)
+{
+	// children are always stored after their parent, so depths are known by the time a node is reached
+	std::vector<int> depths(nodes.size(), 0);
+	for (uint32_t node_index = 0; node_index < nodes.size(); node_index++)
+	{
+		const BVHNode& node = nodes[node_index];
+		if (node.is_leaf())
+		{
+			m_leafCount++;
+			m_depth = std::max(m_depth, depths[node_index]);
+			continue;
+		}
+
+		for (uint32_t child = node.offset; child < node.offset + node.count; child++)
+		{
+			depths[child] = depths[node_index] + 1;
+		}
+	}
+
+	link_nodes();
+	compute_weighted_area();
+}
+
+std::vector<BVH::build_primitive> BVH::compute_primitives(const primitive_list& objects) const
+{
+	std::vector<build_primitive> primitives(objects.size());
+
+	std::for_each(std::execution::par, primitives.begin(), primitives.end(), [&](build_primitive& primitive)
+	{
+		size_t i = &primitive - primitives.data();
+		extent aabb = objects.get_extent(i, { 0,1,2 });
+		glm::vec3 min{ aabb.slabs[0].d_near, aabb.slabs[1].d_near, aabb.slabs[2].d_near };
+		glm::vec3 max{ aabb.slabs[0].d_far, aabb.slabs[1].d_far, aabb.slabs[2].d_far };
+		primitive = { min, max, 0.5f * (min + max) };
+	});
+
+	return primitives;
+}
+
+void BVH::build_tree(uint32_t node_index, const primitive_list& objects, const std::vector<int>& node_object_indices, int depth)
+{
+	if (node_object_indices.size() > (size_t)m_settings.max_leaf_size && depth < m_settings.max_depth)
+	{
+		std::array<std::vector<int>, 8> child_object_indices{};
+
+		for (int index : node_object_indices)
+		{
+			glm::vec3 center = objects.get_centre(index);
+
+			int child_index = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				glm::vec3 normal = extent::plane_set_normals[i];
+				float d_near = nodes[node_index].bounds.slabs[i].d_near;
+				float d_far = nodes[node_index].bounds.slabs[i].d_far;
+				float midpoint = (d_near + d_far) / 2.0f;
+
+				float distance = glm::dot(center, normal);
+
+				if (distance >= midpoint)
+				{
+					child_index |= (1 << i);
+				}
+			}
+
+			child_object_indices[child_index].push_back(index);
+		}
+
+		// empty octants can never be hit so they get no node, the remaining children are allocated as one block
+		uint32_t first_child = nodes.size();
+		uint32_t child_count = 0;
+
+		for (int i = 0; i < 8; i++)
+		{
+			if (child_object_indices[i].empty())
+				continue;
+
+			BVHNode child{};
+			child.bounds = calculate_child_bounds(nodes[node_index].bounds, i);
+
+			for (int index : child_object_indices[i])
+			{
+				child.bounds.expand(objects.get_extent(index, { 0, 1, 2 }));
+			}
+
+			nodes.push_back(child);
+			child_count++;
+		}
+
+		nodes[node_index].leaf = false;
+		nodes[node_index].offset = first_child;
+		nodes[node_index].count = child_count;
+
+		uint32_t child_node = first_child;
+		for (int i = 0; i < 8; i++)
+		{
+			if (!child_object_indices[i].empty())
+			{
+				build_tree(child_node++, objects, child_object_indices[i], depth + 1);
+			}
+		}
+	}
+	else
+	{
+		make_leaf(node_index, objects, node_object_indices.data(), node_object_indices.size(), depth);
+	}
+}
+
+void BVH::build_sah(uint32_t node_index, const primitive_list& objects, const std::vector<build_primitive>& primitives,
+	std::vector<int>& indices, size_t begin, size_t end, int depth)
+{
+	size_t count = end - begin;
+
+	if (count <= 1 || depth >= m_settings.max_depth)
+	{
+		make_leaf(node_index, objects, indices.data() + begin, count, depth);
+		return;
+	}
+
+	glm::vec3 centroid_min{ FLT_MAX };
+	glm::vec3 centroid_max{ -FLT_MAX };
+	for (size_t i = begin; i < end; i++)
+	{
+		centroid_min = glm::min(centroid_min, primitives[indices[i]].centroid);
+		centroid_max = glm::max(centroid_max, primitives[indices[i]].centroid);
+	}
+
+	struct bin
+	{
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+		size_t count{ 0 };
+	};
+
+	const int bin_count = m_settings.sah_bins;
+	std::array<bin, MAX_SAH_BINS> bins;
+	std::array<float, MAX_SAH_BINS> right_area;
+	std::array<size_t, MAX_SAH_BINS> right_count;
+
+	float node_area = nodes[node_index].bounds.surface_area();
+	float best_cost = FLT_MAX;
+	int best_axis = -1;
+	int best_split = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float axis_extent = centroid_max[axis] - centroid_min[axis];
+		if (axis_extent <= 0.0f)
+			continue;
+
+		std::fill(bins.begin(), bins.begin() + bin_count, bin{});
+		float scale = bin_count / axis_extent;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const build_primitive& primitive = primitives[indices[i]];
+			int b = std::min(bin_count - 1, (int)((primitive.centroid[axis] - centroid_min[axis]) * scale));
+			bins[b].min = glm::min(bins[b].min, primitive.min);
+			bins[b].max = glm::max(bins[b].max, primitive.max);
+			bins[b].count++;
+		}
+
+		// sweep from the right to get the cost of everything above each split plane
+		bin accumulated{};
+		for (int b = bin_count - 1; b > 0; b--)
+		{
+			accumulated.min = glm::min(accumulated.min, bins[b].min);
+			accumulated.max = glm::max(accumulated.max, bins[b].max);
+			accumulated.count += bins[b].count;
+			right_area[b] = area(accumulated.min, accumulated.max);
+			right_count[b] = accumulated.count;
+		}
+
+		accumulated = bin{};
+		for (int b = 0; b < bin_count - 1; b++)
+		{
+			accumulated.min = glm::min(accumulated.min, bins[b].min);
+			accumulated.max = glm::max(accumulated.max, bins[b].max);
+			accumulated.count += bins[b].count;
+
+			if (accumulated.count == 0 || right_count[b + 1] == 0)
+				continue;
+
+			float cost = area(accumulated.min, accumulated.max) * accumulated.count + right_area[b + 1] * right_count[b + 1];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	size_t mid = begin + count / 2;
+
+	if (best_axis >= 0)
+	{
+		// descending into the split means testing both child bounds
+		float split_cost = 2.0f * m_settings.traversal_cost + m_settings.intersection_cost * best_cost / std::max(node_area, FLT_MIN);
+		float leaf_cost = m_settings.intersection_cost * count;
+
+		if (count <= (size_t)m_settings.max_leaf_size && leaf_cost <= split_cost)
+		{
+			make_leaf(node_index, objects, indices.data() + begin, count, depth);
+			return;
+		}
+
+		float scale = bin_count / (centroid_max[best_axis] - centroid_min[best_axis]);
+		auto split = std::partition(indices.begin() + begin, indices.begin() + end, [&](int index)
+		{
+			int b = std::min(bin_count - 1, (int)((primitives[index].centroid[best_axis] - centroid_min[best_axis]) * scale));
+			return b <= best_split;
+		});
+
+		mid = split - indices.begin();
+	}
+	// all centroids coincide, keep them together if they fit in a leaf and otherwise split the range in half
+	else if (count <= (size_t)m_settings.max_leaf_size)
+	{
+		make_leaf(node_index, objects, indices.data() + begin, count, depth);
+		return;
+	}
+
+	uint32_t first_child = nodes.size();
+	nodes.resize(nodes.size() + 2);
+
+	std::array<std::pair<size_t, size_t>, 2> ranges{ std::pair{ begin, mid }, std::pair{ mid, end } };
+	for (int c = 0; c < 2; c++)
+	{
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+		for (size_t i = ranges[c].first; i < ranges[c].second; i++)
+		{
+			min = glm::min(min, primitives[indices[i]].min);
+			max = glm::max(max, primitives[indices[i]].max);
+		}
+
+		nodes[first_child + c].bounds = extent::from_aabb(min, max);
+	}
+
+	nodes[node_index].leaf = false;
+	nodes[node_index].offset = first_child;
+	nodes[node_index].count = 2;
+
+	for (int c = 0; c < 2; c++)
+	{
+		build_sah(first_child + c, objects, primitives, indices, ranges[c].first, ranges[c].second, depth + 1);
+	}
+}
+
+void BVH::build_lbvh(const primitive_list& objects)
+{
+	size_t count = objects.size();
+	if (count == 0)
+	{
+		make_leaf(0, objects, nullptr, 0, 0);
+		return;
+	}
+
+	auto start = clock::now();
+	std::vector<build_primitive> primitives = compute_primitives(objects);
+
+	glm::vec3 centroid_min = std::transform_reduce(std::execution::par, primitives.begin(), primitives.end(), glm::vec3(FLT_MAX),
+		[](const glm::vec3& a, const glm::vec3& b) { return glm::min(a, b); },
+		[](const build_primitive& primitive) { return primitive.centroid; });
+	glm::vec3 centroid_max = std::transform_reduce(std::execution::par, primitives.begin(), primitives.end(), glm::vec3(-FLT_MAX),
+		[](const glm::vec3& a, const glm::vec3& b) { return glm::max(a, b); },
+		[](const build_primitive& primitive) { return primitive.centroid; });
+	m_timings.primitives_ms = elapsed_ms(start);
+
+	start = clock::now();
+	glm::vec3 inverse_extent = 1.0f / glm::max(centroid_max - centroid_min, glm::vec3(FLT_MIN));
+
+	std::vector<std::pair<uint64_t, int>> sorted(count);
+	std::for_each(std::execution::par, sorted.begin(), sorted.end(), [&](std::pair<uint64_t, int>& entry)
+	{
+		int i = (int)(&entry - sorted.data());
+		entry = { morton_code((primitives[i].centroid - centroid_min) * inverse_extent), i };
+	});
+	m_timings.morton_ms = elapsed_ms(start);
+
+	start = clock::now();
+	std::sort(std::execution::par, sorted.begin(), sorted.end());
+
+	// leaves reference the sorted order directly so object_indices is the sort result
+	std::vector<uint64_t> codes(count);
+	object_indices.resize(count);
+	std::for_each(std::execution::par, sorted.begin(), sorted.end(), [&](const std::pair<uint64_t, int>& entry)
+	{
+		size_t i = &entry - sorted.data();
+		codes[i] = entry.first;
+		object_indices[i] = entry.second;
+	});
+	m_timings.sort_ms = elapsed_ms(start);
+
+	// the top levels are split serially until the ranges are small enough to hand one to each task
+	start = clock::now();
+	size_t task_count = std::max(1u, std::thread::hardware_concurrency()) * 8;
+	size_t subtree_size = std::max<size_t>({ (size_t)m_settings.max_leaf_size, 64, count / task_count });
+
+	std::vector<lbvh_subtree> subtrees;
+	emit_lbvh_top(0, codes, 0, count, subtree_size, 0, subtrees);
+
+	std::for_each(std::execution::par, subtrees.begin(), subtrees.end(), [&](lbvh_subtree& subtree)
+	{
+		subtree.nodes.reserve(2 * (subtree.end - subtree.begin) / m_settings.max_leaf_size + 1);
+		subtree.nodes.emplace_back();
+		emit_lbvh(subtree, 0, objects, primitives, codes, subtree.begin, subtree.end, 0, subtree.min, subtree.max);
+	});
+	m_timings.emit_ms = elapsed_ms(start);
+
+	start = clock::now();
+	std::vector<std::pair<glm::vec3, glm::vec3>> top_bounds;
+
+	bool morton_top = !(m_settings.lbvh_sah_top && subtrees.size() > 2);
+	if (!morton_top)
+	{
+		// the subtrees were emitted with what depth the Morton top left them, an SAH top can place them
+		// deeper, so the Morton one is put back if that takes any leaf past max_depth
+		std::vector<BVHNode> morton_nodes = nodes;
+		std::vector<std::pair<uint32_t, int>> morton_slots(subtrees.size());
+		std::vector<int> order(subtrees.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = (int)i;
+			morton_slots[i] = { subtrees[i].slot, subtrees[i].depth };
+		}
+
+		nodes.resize(1);
+		glm::vec3 min, max;
+		build_sah_top(subtrees, order, 0, order.size(), 0, 0, min, max);
+
+		morton_top = std::any_of(subtrees.begin(), subtrees.end(), [&](const lbvh_subtree& subtree)
+		{
+			return subtree.depth + subtree.local_depth > m_settings.max_depth;
+		});
+
+		if (morton_top)
+		{
+			nodes = std::move(morton_nodes);
+			for (size_t i = 0; i < subtrees.size(); i++)
+			{
+				subtrees[i].slot = morton_slots[i].first;
+				subtrees[i].depth = morton_slots[i].second;
+			}
+		}
+	}
+
+	if (morton_top)
+	{
+		// Morton top levels only know their bounds once the subtrees are done, children always follow their parent
+		top_bounds.resize(nodes.size(), { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) });
+		for (const lbvh_subtree& subtree : subtrees)
+		{
+			top_bounds[subtree.slot] = { subtree.min, subtree.max };
+		}
+
+		for (size_t i = nodes.size(); i-- > 0;)
+		{
+			if (nodes[i].is_leaf())
+				continue;
+
+			for (uint32_t child = nodes[i].offset; child < nodes[i].offset + nodes[i].count; child++)
+			{
+				top_bounds[i].first = glm::min(top_bounds[i].first, top_bounds[child].first);
+				top_bounds[i].second = glm::max(top_bounds[i].second, top_bounds[child].second);
+			}
+
+			nodes[i].bounds = extent::from_aabb(top_bounds[i].first, top_bounds[i].second);
+		}
+	}
+
+	// splice every subtree in: its root replaces the placeholder slot and the rest is appended
+	std::vector<uint32_t> bases(subtrees.size());
+	size_t node_count = nodes.size();
+	for (size_t i = 0; i < subtrees.size(); i++)
+	{
+		bases[i] = (uint32_t)node_count;
+		node_count += subtrees[i].nodes.size() - 1;
+
+		m_leafCount += subtrees[i].leaf_count;
+		m_depth = std::max(m_depth, subtrees[i].depth + subtrees[i].local_depth);
+	}
+
+	nodes.resize(node_count);
+	std::for_each(std::execution::par, subtrees.begin(), subtrees.end(), [&](lbvh_subtree& subtree)
+	{
+		uint32_t base = bases[&subtree - subtrees.data()];
+
+		for (size_t i = 0; i < subtree.nodes.size(); i++)
+		{
+			BVHNode node = subtree.nodes[i];
+			if (!node.is_leaf())
+			{
+				node.offset = base + node.offset - 1;
+			}
+
+			nodes[i == 0 ? subtree.slot : base + i - 1] = node;
+		}
+
+		subtree.nodes = {};
+	});
+	m_timings.top_ms = elapsed_ms(start);
+}
+
+void BVH::emit_lbvh_top(uint32_t node_index, const std::vector<uint64_t>& codes, size_t begin, size_t end, size_t subtree_size, int depth,
+	std::vector<lbvh_subtree>& subtrees)
+{
+	if (end - begin <= subtree_size || depth >= m_settings.max_depth)
+	{
+		lbvh_subtree subtree{};
+		subtree.begin = begin;
+		subtree.end = end;
+		subtree.slot = node_index;
+		subtree.depth = depth;
+		subtrees.push_back(std::move(subtree));
+		return;
+	}
+
+	size_t mid = find_split(codes, begin, end);
+
+	uint32_t first_child = nodes.size();
+	nodes.resize(nodes.size() + 2);
+
+	nodes[node_index].leaf = false;
+	nodes[node_index].offset = first_child;
+	nodes[node_index].count = 2;
+
+	emit_lbvh_top(first_child, codes, begin, mid, subtree_size, depth + 1, subtrees);
+	emit_lbvh_top(first_child + 1, codes, mid, end, subtree_size, depth + 1, subtrees);
+}
+
+void BVH::emit_lbvh(lbvh_subtree& subtree, uint32_t local_index, const primitive_list& objects, const std::vector<build_primitive>& primitives,
+	const std::vector<uint64_t>& codes, size_t begin, size_t end, int depth, glm::vec3& min, glm::vec3& max) const
+{
+	size_t count = end - begin;
+
+	if (count <= (size_t)m_settings.max_leaf_size || subtree.depth + depth >= m_settings.max_depth)
+	{
+		BVHNode& node = subtree.nodes[local_index];
+		node.leaf = true;
+		node.offset = begin;
+		node.count = count;
+
+		node.bounds = objects.get_extent(object_indices[begin], { 3,4,5,6 });
+		min = primitives[object_indices[begin]].min;
+		max = primitives[object_indices[begin]].max;
+
+		for (size_t i = begin + 1; i < end; i++)
+		{
+			node.bounds.expand(objects.get_extent(object_indices[i], { 3,4,5,6 }));
+			min = glm::min(min, primitives[object_indices[i]].min);
+			max = glm::max(max, primitives[object_indices[i]].max);
+		}
+
+		subtree.leaf_count++;
+		subtree.local_depth = std::max(subtree.local_depth, depth);
+		return;
+	}
+
+	size_t mid = find_split(codes, begin, end);
+
+	uint32_t first_child = subtree.nodes.size();
+	subtree.nodes.resize(subtree.nodes.size() + 2);
+
+	glm::vec3 left_min, left_max, right_min, right_max;
+	emit_lbvh(subtree, first_child, objects, primitives, codes, begin, mid, depth + 1, left_min, left_max);
+	emit_lbvh(subtree, first_child + 1, objects, primitives, codes, mid, end, depth + 1, right_min, right_max);
+
+	min = glm::min(left_min, right_min);
+	max = glm::max(left_max, right_max);
+
+	BVHNode& node = subtree.nodes[local_index];
+	node.leaf = false;
+	node.offset = first_child;
+	node.count = 2;
+	node.bounds = extent::from_aabb(min, max);
+}
+
+void BVH::build_sah_top(std::vector<lbvh_subtree>& subtrees, std::vector<int>& order, size_t begin, size_t end, uint32_t node_index, int depth,
+	glm::vec3& min, glm::vec3& max)
+{
+	if (end - begin == 1)
+	{
+		lbvh_subtree& subtree = subtrees[order[begin]];
+		subtree.slot = node_index;
+		subtree.depth = depth;
+		min = subtree.min;
+		max = subtree.max;
+		return;
+	}
+
+	// there are only a few hundred subtrees at most, so every split position on every axis is evaluated
+	auto centroid = [&](int i, int axis) { return subtrees[i].min[axis] + subtrees[i].max[axis]; };
+
+	size_t count = end - begin;
+	std::vector<float> right_cost(count);
+	float best_cost = FLT_MAX;
+	int best_axis = 0;
+	size_t best_split = begin + count / 2;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		std::sort(order.begin() + begin, order.begin() + end, [&](int a, int b) { return centroid(a, axis) < centroid(b, axis); });
+
+		glm::vec3 right_min{ FLT_MAX }, right_max{ -FLT_MAX };
+		size_t right_primitives = 0;
+		for (size_t i = end; i-- > begin + 1;)
+		{
+			const lbvh_subtree& subtree = subtrees[order[i]];
+			right_min = glm::min(right_min, subtree.min);
+			right_max = glm::max(right_max, subtree.max);
+			right_primitives += subtree.end - subtree.begin;
+			right_cost[i - begin] = area(right_min, right_max) * right_primitives;
+		}
+
+		glm::vec3 left_min{ FLT_MAX }, left_max{ -FLT_MAX };
+		size_t left_primitives = 0;
+		for (size_t i = begin; i < end - 1; i++)
+		{
+			const lbvh_subtree& subtree = subtrees[order[i]];
+			left_min = glm::min(left_min, subtree.min);
+			left_max = glm::max(left_max, subtree.max);
+			left_primitives += subtree.end - subtree.begin;
+
+			float cost = area(left_min, left_max) * left_primitives + right_cost[i + 1 - begin];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = i + 1;
+			}
+		}
+	}
+
+	if (best_axis != 2)
+	{
+		std::sort(order.begin() + begin, order.begin() + end, [&](int a, int b) { return centroid(a, best_axis) < centroid(b, best_axis); });
+	}
+
+	uint32_t first_child = nodes.size();
+	nodes.resize(nodes.size() + 2);
+
+	glm::vec3 left_min, left_max, right_min, right_max;
+	build_sah_top(subtrees, order, begin, best_split, first_child, depth + 1, left_min, left_max);
+	build_sah_top(subtrees, order, best_split, end, first_child + 1, depth + 1, right_min, right_max);
+
+	min = glm::min(left_min, right_min);
+	max = glm::max(left_max, right_max);
+
+	BVHNode& node = nodes[node_index];
+	node.leaf = false;
+	node.offset = first_child;
+	node.count = 2;
+	node.bounds = extent::from_aabb(min, max);
+}
+
+void BVH::make_leaf(uint32_t node_index, const primitive_list& objects, const int* indices, size_t count, int depth)
+{
+	BVHNode& node = nodes[node_index];
+	node.leaf = true;
+	node.offset = object_indices.size();
+	node.count = count;
+
+	object_indices.insert(object_indices.end(), indices, indices + count);
+
+	m_leafCount++;
+	m_depth = std::max(m_depth, depth);
+
+	// recalculate tight final bounds for node's objects
+	if (count > 0)
+	{
+		node.bounds = objects.get_extent(indices[0], { 3,4,5,6 });
+		for (size_t i = 1; i < count; i++) {
+			node.bounds.expand(objects.get_extent(indices[i], { 3,4,5,6 }));
+		}
+	}
+}
+
+void BVH::link_nodes()
+{
+	object_leaves.resize(object_indices.size());
+
+	std::for_each(std::execution::par, nodes.begin(), nodes.end(), [&](const BVHNode& node)
+	{
+		uint32_t node_index = &node - nodes.data();
+
+		if (node.is_leaf())
+		{
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+			{
+				object_leaves[object_indices[i]] = node_index;
+			}
+		}
+		else
+		{
+			for (uint32_t child = node.offset; child < node.offset + node.count; child++)
+			{
+				nodes[child].parent = node_index;
+			}
+		}
+	});
+}
+
+void BVH::compute_cost(const primitive_list& objects)
+{
+	std::for_each(std::execution::par, nodes.begin(), nodes.end(), [&](BVHNode& node)
+	{
+		node.area = node_area(objects, node);
+	});
+
+	compute_weighted_area();
+	m_buildCost = get_cost();
+}
+
+void BVH::compute_weighted_area()
+{
+	m_weightedArea = std::transform_reduce(std::execution::par, nodes.begin(), nodes.end(), 0.0f, std::plus<>(), [&](const BVHNode& node)
+	{
+		return node_weight(node) * node.area;
+	});
+}
+
+float BVH::node_area(const primitive_list& objects, const BVHNode& node) const
+{
+	if (!node.is_leaf())
+		return node.bounds.surface_area();
+
+	// leaves carry octahedral bounds, so their area is measured on the axis-aligned box of their objects instead
+	extent aabb{};
+	for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+	{
+		aabb.expand(objects.get_extent(object_indices[i], { 0,1,2 }));
+	}
+
+	return aabb.surface_area();
+}
+
+float BVH::node_weight(const BVHNode& node) const
+{
+	// charge every child bounds test so octree and binary trees are comparable
+	return node.is_leaf()
+		? m_settings.intersection_cost * node.count
+		: m_settings.traversal_cost * node.count;
+}
+
+void BVH::refit(const primitive_list& objects, const std::vector<int>& dirty_objects)
+{
+	// children are always stored after their parent, so visiting nodes by descending index refits bottom-up
+	std::vector<uint32_t> dirty_nodes;
+	for (int object_index : dirty_objects)
+	{
+		for (uint32_t node = object_leaves[object_index]; ; node = nodes[node].parent)
+		{
+			dirty_nodes.push_back(node);
+			if (node == 0)
+				break;
+		}
+	}
+
+	std::sort(dirty_nodes.begin(), dirty_nodes.end(), std::greater<>());
+	dirty_nodes.erase(std::unique(dirty_nodes.begin(), dirty_nodes.end()), dirty_nodes.end());
+
+	for (uint32_t node_index : dirty_nodes)
+	{
+		BVHNode& node = nodes[node_index];
+
+		if (node.is_leaf())
+		{
+			node.bounds = objects.get_extent(object_indices[node.offset], { 3,4,5,6 });
+			for (uint32_t i = node.offset + 1; i < node.offset + node.count; i++)
+			{
+				node.bounds.expand(objects.get_extent(object_indices[i], { 3,4,5,6 }));
+			}
+		}
+		else
+		{
+			// interior bounds become the box around the children, for leaves that is the box around their objects
+			extent aabb{};
+			for (uint32_t child = node.offset; child < node.offset + node.count; child++)
+			{
+				if (nodes[child].is_leaf())
+				{
+					for (uint32_t i = nodes[child].offset; i < nodes[child].offset + nodes[child].count; i++)
+					{
+						aabb.expand(objects.get_extent(object_indices[i], { 0,1,2 }));
+					}
+				}
+				else
+				{
+					aabb.expand(nodes[child].bounds);
+				}
+			}
+
+			node.bounds = aabb;
+		}
+
+		float area = node_area(objects, node);
+		m_weightedArea += node_weight(node) * (area - node.area);
+		node.area = area;
+	}
+}
+
+bool BVH::update(const primitive_list& objects, const std::vector<int>& dirty_objects)
+{
+	if (dirty_objects.empty())
+		return false;
+
+	refit(objects, dirty_objects);
+
+	if (get_cost() <= m_buildCost * m_settings.rebuild_threshold)
+		return false;
+
+	*this = BVH(objects, m_settings);
+	return true;
+}
+
+BVH::node_layout BVH::resolve_layout(node_layout layout)
+{
+	if (layout != node_layout::automatic)
+		return layout;
+
+	switch (simd::get())
+	{
+	case simd::level::avx2: return node_layout::bvh8;
+	case simd::level::sse: return node_layout::bvh4;
+	default: return node_layout::scalar;
+	}
+}
+
+int BVH::intersect(const ray& ray, const sphere_set& spheres, float tMin, float& closestT, int& instancePrimitive) const
+{
+	int closestPrimitive = -1;
+
+	struct stack_entry
+	{
+		float t;
+		uint32_t node;
+	};
+
+	// fixed-size traversal stack, nearest candidate is kept on top
+	std::array<stack_entry, MAX_STACK_SIZE> stack;
+	int stackSize = 0;
+
+	float rootT = root().bounds.hit(ray);
+	RT_STAT(boxTests, 1);
+
+	if (rootT >= 0.0f)
+	{
+		stack[stackSize++] = { rootT, 0 };
+	}
+
+	while (stackSize > 0)
+	{
+		auto [currentNodeT, currentNodeIndex] = stack[--stackSize];
+
+		if (currentNodeT >= closestT)
+		{
+			continue;
+		}
+
+		const BVHNode& currentNode = nodes[currentNodeIndex];
+		RT_STAT(nodesVisited, 1);
+
+		if (currentNode.is_leaf())
+		{
+			RT_STAT(primitiveTests, currentNode.count);
+			int primitive = spheres.intersect(ray, currentNode.offset, currentNode.count, tMin, closestT, instancePrimitive);
+			if (primitive >= 0)
+			{
+				closestPrimitive = primitive;
+			}
+		}
+		else
+		{
+			// sort the children that were hit by descending distance so the closest one is popped first
+			std::array<stack_entry, 8> childHits;
+			int childHitCount = 0;
+			RT_STAT(boxTests, currentNode.count);
+
+			for (uint32_t child = currentNode.offset; child < currentNode.offset + currentNode.count; child++)
+			{
+				float t = nodes[child].bounds.hit(ray);
+
+				if (t >= 0.0f && t < closestT)
+				{
+					int j = childHitCount++;
+					for (; j > 0 && childHits[j - 1].t < t; j--)
+					{
+						childHits[j] = childHits[j - 1];
+					}
+					childHits[j] = { t, child };
+				}
+			}
+
+			for (int i = 0; i < childHitCount; i++)
+			{
+				stack[stackSize++] = childHits[i];
+			}
+		}
+	}
+
+	return closestPrimitive;
+}
+
+bool BVH::occluded(const ray& ray, const sphere_set& spheres, float tMin, float tMax) const
+{
+	// no closest hit to narrow towards, so children are pushed as they come instead of sorted
+	std::array<uint32_t, MAX_STACK_SIZE> stack;
+	int stackSize = 0;
+
+	float rootT = root().bounds.hit(ray);
+	RT_STAT(boxTests, 1);
+
+	if (rootT >= 0.0f && rootT < tMax)
+	{
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0)
+	{
+		const BVHNode& currentNode = nodes[stack[--stackSize]];
+		RT_STAT(nodesVisited, 1);
+
+		if (currentNode.is_leaf())
+		{
+			RT_STAT(primitiveTests, currentNode.count);
+			if (spheres.occluded(ray, currentNode.offset, currentNode.count, tMin, tMax))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		RT_STAT(boxTests, currentNode.count);
+		for (uint32_t child = currentNode.offset; child < currentNode.offset + currentNode.count; child++)
+		{
+			float t = nodes[child].bounds.hit(ray);
+
+			if (t >= 0.0f && t < tMax)
+			{
+				stack[stackSize++] = child;
+			}
+		}
+	}
+
+	return false;
+}
+
+extent BVH::calculate_child_bounds(const extent& parent_bounds, int index) const
+{
+	extent child_bounds = parent_bounds;
+
+	for (int i = 0; i < 3; i++)
+	{
+		float d_near = parent_bounds.slabs[i].d_near;
+		float d_far = parent_bounds.slabs[i].d_far;
+		float midpoint = (d_near + d_far) / 2.0f;
+
+		if (index & (1 << i))
+		{
+			child_bounds.slabs[i].d_near = midpoint;
+		}
+		else
+		{
+			child_bounds.slabs[i].d_far = midpoint;
+		}
+	}
+
+	return child_bounds;
+}
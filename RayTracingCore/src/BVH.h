@@ -0,0 +1,190 @@
+#pragma once
+#include <vector>
+#include "primitive_list.h"
+#include <memory>
+#include <execution>
+#include <cstdint>
+#include <cfloat>
+
+class sphere_set;
+
+// Nodes live in one contiguous array. An interior node's children are stored next to each other
+// starting at `offset`; a leaf covers object_indices[offset, offset + count).
+struct alignas(64) BVHNode
+{
+	extent bounds;
+	uint32_t offset{ 0 };
+	uint32_t count{ 0 };
+	uint32_t parent{ 0 };
+	float area{ 0.0f }; // axis-aligned surface area, kept for SAH cost bookkeeping
+	bool leaf{ true };
+
+	bool is_leaf() const
+	{
+		return leaf;
+	}
+};
+
+class BVH
+{
+public:
+	enum class build_strategy
+	{
+		octree,	// 8-way spatial midpoint split
+		sah,	// binary split chosen by binned surface area heuristic
+		lbvh	// parallel build from Morton-code sorted primitives
+	};
+
+	// node layout used for traversal, wide layouts are collapsed from the built tree
+	enum class node_layout
+	{
+		automatic,	// widest layout the CPU has SIMD support for
+		scalar,		// the tree as built, one extent test per child
+		bvh4,
+		bvh8
+	};
+
+	struct build_settings
+	{
+		build_strategy strategy{ build_strategy::octree };
+		node_layout layout{ node_layout::automatic };
+		int max_leaf_size{ 4 };
+		int max_depth{ 48 };
+
+		// SAH only
+		int sah_bins{ 16 };
+		float traversal_cost{ 1.0f };
+		float intersection_cost{ 1.0f };
+
+		// LBVH only, rebuilds the levels above the parallel subtrees with a full SAH sweep, unless that
+		// would take the tree past max_depth
+		bool lbvh_sah_top{ true };
+
+		// update() falls back to a full rebuild once refitting has raised the SAH cost by this factor
+		float rebuild_threshold{ 1.5f };
+	};
+
+	// wall-clock time spent in each build phase, phases a strategy doesn't have stay at zero
+	struct build_timings
+	{
+		float primitives_ms{ 0.0f };
+		float morton_ms{ 0.0f };
+		float sort_ms{ 0.0f };
+		float emit_ms{ 0.0f };
+		float top_ms{ 0.0f };
+		float total_ms{ 0.0f };
+	};
+
+	std::vector<BVHNode> nodes;
+	std::vector<int> object_indices;
+	std::vector<uint32_t> object_leaves; // leaf node holding each object
+
+	// upper bound on pending nodes during traversal
+	static constexpr int MAX_STACK_SIZE{ 256 };
+
+	// hard limits on tree depth regardless of settings, keep the traversal stack bounded.
+	// every level of an 8-way node can leave 7 siblings on the stack, a binary node only 1
+	static constexpr int MAX_OCTREE_DEPTH{ (MAX_STACK_SIZE - 1) / 7 };
+	static constexpr int MAX_DEPTH{ MAX_STACK_SIZE - 1 };
+
+	static constexpr int MAX_SAH_BINS{ 32 };
+
+	BVH(const primitive_list& objects);
+	BVH(const primitive_list& objects, const build_settings& settings);
+
+	// adopts a tree built earlier for the same objects, as read back from a scene file. Node areas are
+	// kept as given, build_cost is the cost the tree had when it was built and the timings stay zero
+	BVH(std::vector<BVHNode> nodes, std::vector<int> object_indices, const build_settings& settings, float build_cost);
+
+	const BVHNode& root() const { return nodes[0]; }
+
+	// closest hit in [tMin, closestT) through the tree as built, returns the primitive index into spheres or -1 and narrows closestT.
+	// instancePrimitive is set as in sphere_set::intersect
+	int intersect(const ray& ray, const sphere_set& spheres, float tMin, float& closestT, int& instancePrimitive) const;
+
+	// true if anything is hit in [tMin, tMax), stops at the first hit found
+	bool occluded(const ray& ray, const sphere_set& spheres, float tMin, float tMax) const;
+
+	const build_settings& get_settings() const { return m_settings; }
+
+	// the layout automatic stands for on this CPU, any other layout is returned as it is
+	static node_layout resolve_layout(node_layout layout);
+
+	// recomputes the bounds of the leaves holding dirty_objects and of their ancestors only,
+	// the objects must still be the ones the tree was built from
+	void refit(const primitive_list& objects, const std::vector<int>& dirty_objects);
+
+	// refits, or rebuilds from scratch if the refitted tree has degraded past rebuild_threshold.
+	// returns true if a full rebuild happened
+	bool update(const primitive_list& objects, const std::vector<int>& dirty_objects);
+
+	// expected cost of tracing a random ray, relative to the root's surface area
+	float get_cost() const { return m_weightedArea / std::max(nodes[0].area, FLT_MIN); }
+	float get_build_cost() const { return m_buildCost; }
+	int get_depth() const { return m_depth; }
+	size_t get_leaf_count() const { return m_leafCount; }
+
+	const build_timings& get_timings() const { return m_timings; }
+
+private:
+	struct build_primitive
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		glm::vec3 centroid;
+	};
+
+	// a range of Morton-sorted primitives built on its own thread into a local node array,
+	// `slot` is the node in the top levels that its root is copied into
+	struct lbvh_subtree
+	{
+		size_t begin{ 0 };
+		size_t end{ 0 };
+		uint32_t slot{ 0 };
+		int depth{ 0 };
+
+		std::vector<BVHNode> nodes;
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+		size_t leaf_count{ 0 };
+		int local_depth{ 0 };
+	};
+
+	build_settings m_settings;
+	build_timings m_timings;
+
+	float m_weightedArea{ 0.0f };
+	float m_buildCost{ 0.0f };
+	int m_depth{ 0 };
+	size_t m_leafCount{ 0 };
+
+	void build_tree(uint32_t node_index, const primitive_list& objects, const std::vector<int>& object_indices, int depth);
+
+	void build_sah(uint32_t node_index, const primitive_list& objects, const std::vector<build_primitive>& primitives,
+		std::vector<int>& indices, size_t begin, size_t end, int depth);
+
+	void build_lbvh(const primitive_list& objects);
+
+	void emit_lbvh_top(uint32_t node_index, const std::vector<uint64_t>& codes, size_t begin, size_t end, size_t subtree_size, int depth,
+		std::vector<lbvh_subtree>& subtrees);
+
+	void emit_lbvh(lbvh_subtree& subtree, uint32_t local_index, const primitive_list& objects, const std::vector<build_primitive>& primitives,
+		const std::vector<uint64_t>& codes, size_t begin, size_t end, int depth, glm::vec3& min, glm::vec3& max) const;
+
+	void build_sah_top(std::vector<lbvh_subtree>& subtrees, std::vector<int>& order, size_t begin, size_t end, uint32_t node_index, int depth,
+		glm::vec3& min, glm::vec3& max);
+
+	std::vector<build_primitive> compute_primitives(const primitive_list& objects) const;
+
+	void make_leaf(uint32_t node_index, const primitive_list& objects, const int* indices, size_t count, int depth);
+
+	void link_nodes();
+
+	void compute_cost(const primitive_list& objects);
+	void compute_weighted_area();
+
+	float node_area(const primitive_list& objects, const BVHNode& node) const;
+	float node_weight(const BVHNode& node) const;
+
+	extent calculate_child_bounds(const extent& parent_bounds, int index) const;
+};
@@ -0,0 +1,484 @@
+#include "WideBVH.h"
+#include "ray_stats.h"
+
+namespace
+{
+	struct prepared_ray
+	{
+		glm::vec3 origin;
+		glm::vec3 inverse_direction;
+		int sign[3]; // 1 where the direction is negative, selects which side of a box is entered first
+	};
+
+	prepared_ray prepare(const ray& ray)
+	{
+		prepared_ray prepared{};
+		prepared.origin = ray.origin;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// keep the reciprocal finite so empty slots give +inf instead of NaN
+			float d = ray.direction[axis];
+			if (glm::abs(d) < 1e-8f)
+				d = d < 0.0f ? -1e-8f : 1e-8f;
+
+			prepared.inverse_direction[axis] = 1.0f / d;
+			prepared.sign[axis] = d < 0.0f ? 1 : 0;
+		}
+
+		return prepared;
+	}
+
+	// All kernels pick the near and far plane per axis from the ray direction instead of sorting
+	// the two slab distances, that way an inverted box always has t_near > t_far and misses.
+
+	template <int WIDTH>
+	struct scalar_kernel
+	{
+		static int intersect(const WideBVHNode<WIDTH>& node, const prepared_ray& r, float closestT, float* distances)
+		{
+			const float* near_x = r.sign[0] ? node.max_x : node.min_x;
+			const float* near_y = r.sign[1] ? node.max_y : node.min_y;
+			const float* near_z = r.sign[2] ? node.max_z : node.min_z;
+			const float* far_x = r.sign[0] ? node.min_x : node.max_x;
+			const float* far_y = r.sign[1] ? node.min_y : node.max_y;
+			const float* far_z = r.sign[2] ? node.min_z : node.max_z;
+
+			int mask = 0;
+			for (int i = 0; i < WIDTH; i++)
+			{
+				float t_near = glm::max(
+					glm::max((near_x[i] - r.origin.x) * r.inverse_direction.x, (near_y[i] - r.origin.y) * r.inverse_direction.y),
+					glm::max((near_z[i] - r.origin.z) * r.inverse_direction.z, 0.0f));
+				float t_far = glm::min(
+					glm::min((far_x[i] - r.origin.x) * r.inverse_direction.x, (far_y[i] - r.origin.y) * r.inverse_direction.y),
+					glm::min((far_z[i] - r.origin.z) * r.inverse_direction.z, closestT));
+
+				distances[i] = t_near;
+				if (t_near <= t_far)
+				{
+					mask |= 1 << i;
+				}
+			}
+
+			return mask;
+		}
+	};
+
+#if RT_SIMD_X86
+	struct sse_kernel
+	{
+		static int intersect(const WideBVHNode<4>& node, const prepared_ray& r, float closestT, float* distances)
+		{
+			__m128 origin_x = _mm_set1_ps(r.origin.x);
+			__m128 origin_y = _mm_set1_ps(r.origin.y);
+			__m128 origin_z = _mm_set1_ps(r.origin.z);
+			__m128 inverse_x = _mm_set1_ps(r.inverse_direction.x);
+			__m128 inverse_y = _mm_set1_ps(r.inverse_direction.y);
+			__m128 inverse_z = _mm_set1_ps(r.inverse_direction.z);
+
+			__m128 near_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(r.sign[0] ? node.max_x : node.min_x), origin_x), inverse_x);
+			__m128 near_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(r.sign[1] ? node.max_y : node.min_y), origin_y), inverse_y);
+			__m128 near_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(r.sign[2] ? node.max_z : node.min_z), origin_z), inverse_z);
+			__m128 far_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(r.sign[0] ? node.min_x : node.max_x), origin_x), inverse_x);
+			__m128 far_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(r.sign[1] ? node.min_y : node.max_y), origin_y), inverse_y);
+			__m128 far_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(r.sign[2] ? node.min_z : node.max_z), origin_z), inverse_z);
+
+			__m128 t_near = _mm_max_ps(_mm_max_ps(near_x, near_y), _mm_max_ps(near_z, _mm_setzero_ps()));
+			__m128 t_far = _mm_min_ps(_mm_min_ps(far_x, far_y), _mm_min_ps(far_z, _mm_set1_ps(closestT)));
+
+			_mm_store_ps(distances, t_near);
+			return _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+		}
+	};
+
+	struct avx2_kernel
+	{
+		RT_TARGET_AVX2 static int intersect(const WideBVHNode<8>& node, const prepared_ray& r, float closestT, float* distances)
+		{
+			__m256 origin_x = _mm256_set1_ps(r.origin.x);
+			__m256 origin_y = _mm256_set1_ps(r.origin.y);
+			__m256 origin_z = _mm256_set1_ps(r.origin.z);
+			__m256 inverse_x = _mm256_set1_ps(r.inverse_direction.x);
+			__m256 inverse_y = _mm256_set1_ps(r.inverse_direction.y);
+			__m256 inverse_z = _mm256_set1_ps(r.inverse_direction.z);
+
+			__m256 near_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(r.sign[0] ? node.max_x : node.min_x), origin_x), inverse_x);
+			__m256 near_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(r.sign[1] ? node.max_y : node.min_y), origin_y), inverse_y);
+			__m256 near_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(r.sign[2] ? node.max_z : node.min_z), origin_z), inverse_z);
+			__m256 far_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(r.sign[0] ? node.min_x : node.max_x), origin_x), inverse_x);
+			__m256 far_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(r.sign[1] ? node.min_y : node.max_y), origin_y), inverse_y);
+			__m256 far_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(r.sign[2] ? node.min_z : node.max_z), origin_z), inverse_z);
+
+			__m256 t_near = _mm256_max_ps(_mm256_max_ps(near_x, near_y), _mm256_max_ps(near_z, _mm256_setzero_ps()));
+			__m256 t_far = _mm256_min_ps(_mm256_min_ps(far_x, far_y), _mm256_min_ps(far_z, _mm256_set1_ps(closestT)));
+
+			_mm256_store_ps(distances, t_near);
+			return _mm256_movemask_ps(_mm256_cmp_ps(t_near, t_far, _CMP_LE_OQ));
+		}
+	};
+#endif
+}
+
+template <int WIDTH>
+WideBVH<WIDTH>::WideBVH(const BVH& bvh, const primitive_list& objects)
+{
+	nodes.reserve(bvh.nodes.size() / (WIDTH / 2) + 1);
+	m_parents.reserve(nodes.capacity());
+	m_objectSlots.resize(objects.size());
+
+	const BVHNode& root = bvh.root();
+	std::vector<uint32_t> sources{ 0 };
+
+	if (!root.is_leaf())
+	{
+		sources.clear();
+		for (uint32_t child = root.offset; child < root.offset + root.count; child++)
+		{
+			sources.push_back(child);
+		}
+	}
+
+	emit(bvh, objects, sources);
+}
+
+template <int WIDTH>
+uint32_t WideBVH<WIDTH>::emit(const BVH& bvh, const primitive_list& objects, std::vector<uint32_t> slots)
+{
+	uint32_t node_index = nodes.size();
+	nodes.emplace_back();
+	m_parents.push_back({ 0, 0 });
+
+	for (int i = 0; i < WIDTH; i++)
+	{
+		set_slot(node_index, i, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+		nodes[node_index].offset[i] = 0;
+		nodes[node_index].count[i] = 0;
+	}
+
+	// pull grandchildren up by opening the interior slot with the largest surface area while its children still fit
+	while (true)
+	{
+		int best = -1;
+		float best_area = -1.0f;
+
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			const BVHNode& source = bvh.nodes[slots[i]];
+			if (!source.is_leaf() && slots.size() - 1 + source.count <= WIDTH && source.area > best_area)
+			{
+				best = (int)i;
+				best_area = source.area;
+			}
+		}
+
+		if (best < 0)
+			break;
+
+		const BVHNode& opened = bvh.nodes[slots[best]];
+		slots.erase(slots.begin() + best);
+		for (uint32_t child = opened.offset; child < opened.offset + opened.count; child++)
+		{
+			slots.push_back(child);
+		}
+	}
+
+	// more children than slots (an octree node in a BVH4) are split into groups of neighbouring children
+	std::vector<std::vector<uint32_t>> groups;
+	size_t group_count = std::min<size_t>(slots.size(), WIDTH);
+	for (size_t g = 0; g < group_count; g++)
+	{
+		size_t begin = slots.size() * g / group_count;
+		size_t end = slots.size() * (g + 1) / group_count;
+		groups.emplace_back(slots.begin() + begin, slots.begin() + end);
+	}
+
+	for (size_t i = 0; i < groups.size(); i++)
+	{
+		glm::vec3 min, max;
+		const BVHNode& source = bvh.nodes[groups[i][0]];
+
+		if (groups[i].size() == 1 && source.is_leaf())
+		{
+			if (source.count == 0)
+				continue;
+
+			leaf_bounds(bvh, objects, source.offset, source.count, min, max);
+
+			nodes[node_index].offset[i] = source.offset;
+			nodes[node_index].count[i] = source.count;
+
+			for (uint32_t p = source.offset; p < source.offset + source.count; p++)
+			{
+				m_objectSlots[bvh.object_indices[p]] = { node_index, (uint32_t)i };
+			}
+		}
+		else
+		{
+			std::vector<uint32_t> child_slots;
+			if (groups[i].size() == 1)
+			{
+				for (uint32_t child = source.offset; child < source.offset + source.count; child++)
+				{
+					child_slots.push_back(child);
+				}
+			}
+			else
+			{
+				child_slots = groups[i];
+			}
+
+			uint32_t child = emit(bvh, objects, child_slots);
+			node_bounds(child, min, max);
+
+			m_parents[child] = { node_index, (uint32_t)i };
+			nodes[node_index].offset[i] = child;
+			nodes[node_index].count[i] = 0;
+		}
+
+		set_slot(node_index, i, min, max);
+	}
+
+	return node_index;
+}
+
+template <int WIDTH>
+void WideBVH<WIDTH>::refit(const BVH& bvh, const primitive_list& objects, const std::vector<int>& dirty_objects)
+{
+	// nodes are emitted before their children, so descending indices visit children first
+	std::vector<uint32_t> dirty_nodes;
+
+	for (int object_index : dirty_objects)
+	{
+		auto [node_index, slot] = m_objectSlots[object_index];
+		WideBVHNode<WIDTH>& node = nodes[node_index];
+
+		glm::vec3 min, max;
+		leaf_bounds(bvh, objects, node.offset[slot], node.count[slot], min, max);
+		set_slot(node_index, slot, min, max);
+
+		for (uint32_t n = node_index; n != 0; n = m_parents[n].node)
+		{
+			dirty_nodes.push_back(n);
+		}
+	}
+
+	std::sort(dirty_nodes.begin(), dirty_nodes.end(), std::greater<>());
+	dirty_nodes.erase(std::unique(dirty_nodes.begin(), dirty_nodes.end()), dirty_nodes.end());
+
+	for (uint32_t node_index : dirty_nodes)
+	{
+		glm::vec3 min, max;
+		node_bounds(node_index, min, max);
+		set_slot(m_parents[node_index].node, m_parents[node_index].slot, min, max);
+	}
+}
+
+template <int WIDTH>
+void WideBVH<WIDTH>::set_slot(uint32_t node_index, uint32_t slot, const glm::vec3& min, const glm::vec3& max)
+{
+	WideBVHNode<WIDTH>& node = nodes[node_index];
+	node.min_x[slot] = min.x;
+	node.min_y[slot] = min.y;
+	node.min_z[slot] = min.z;
+	node.max_x[slot] = max.x;
+	node.max_y[slot] = max.y;
+	node.max_z[slot] = max.z;
+}
+
+template <int WIDTH>
+void WideBVH<WIDTH>::node_bounds(uint32_t node_index, glm::vec3& min, glm::vec3& max) const
+{
+	const WideBVHNode<WIDTH>& node = nodes[node_index];
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+
+	for (int i = 0; i < WIDTH; i++)
+	{
+		min = glm::min(min, glm::vec3(node.min_x[i], node.min_y[i], node.min_z[i]));
+		max = glm::max(max, glm::vec3(node.max_x[i], node.max_y[i], node.max_z[i]));
+	}
+}
+
+template <int WIDTH>
+void WideBVH<WIDTH>::leaf_bounds(const BVH& bvh, const primitive_list& objects, uint32_t offset, uint32_t count,
+	glm::vec3& min, glm::vec3& max) const
+{
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+
+	for (uint32_t i = offset; i < offset + count; i++)
+	{
+		extent aabb = objects.get_extent(bvh.object_indices[i], { 0,1,2 });
+		min = glm::min(min, glm::vec3(aabb.slabs[0].d_near, aabb.slabs[1].d_near, aabb.slabs[2].d_near));
+		max = glm::max(max, glm::vec3(aabb.slabs[0].d_far, aabb.slabs[1].d_far, aabb.slabs[2].d_far));
+	}
+}
+
+template <int WIDTH>
+int WideBVH<WIDTH>::intersect(const ray& ray, const sphere_set& spheres, float tMin, float& closestT, int& instancePrimitive) const
+{
+#if RT_SIMD_X86
+	if constexpr (WIDTH == 4)
+	{
+		if (simd::get() >= simd::level::sse)
+			return traverse<sse_kernel>(ray, spheres, tMin, closestT, instancePrimitive);
+	}
+	else if constexpr (WIDTH == 8)
+	{
+		if (simd::get() >= simd::level::avx2)
+			return traverse<avx2_kernel>(ray, spheres, tMin, closestT, instancePrimitive);
+	}
+#endif
+
+	return traverse<scalar_kernel<WIDTH>>(ray, spheres, tMin, closestT, instancePrimitive);
+}
+
+template <int WIDTH>
+bool WideBVH<WIDTH>::occluded(const ray& ray, const sphere_set& spheres, float tMin, float tMax) const
+{
+#if RT_SIMD_X86
+	if constexpr (WIDTH == 4)
+	{
+		if (simd::get() >= simd::level::sse)
+			return traverse_any<sse_kernel>(ray, spheres, tMin, tMax);
+	}
+	else if constexpr (WIDTH == 8)
+	{
+		if (simd::get() >= simd::level::avx2)
+			return traverse_any<avx2_kernel>(ray, spheres, tMin, tMax);
+	}
+#endif
+
+	return traverse_any<scalar_kernel<WIDTH>>(ray, spheres, tMin, tMax);
+}
+
+template <int WIDTH>
+bool WideBVH<WIDTH>::is_vectorised() const
+{
+	return (WIDTH == 4 && simd::get() >= simd::level::sse) || (WIDTH == 8 && simd::get() >= simd::level::avx2);
+}
+
+template <int WIDTH>
+template <typename Kernel>
+int WideBVH<WIDTH>::traverse(const ray& ray, const sphere_set& spheres, float tMin, float& closestT, int& instancePrimitive) const
+{
+	struct stack_entry
+	{
+		float t;
+		uint32_t node;
+	};
+
+	std::array<stack_entry, MAX_STACK_SIZE> stack;
+	int stackSize = 0;
+	stack[stackSize++] = { 0.0f, 0 };
+
+	prepared_ray prepared = prepare(ray);
+	int closestPrimitive = -1;
+
+	alignas(32) float distances[WIDTH];
+
+	while (stackSize > 0)
+	{
+		auto [currentNodeT, currentNodeIndex] = stack[--stackSize];
+
+		if (currentNodeT >= closestT)
+		{
+			continue;
+		}
+
+		const WideBVHNode<WIDTH>& node = nodes[currentNodeIndex];
+		int mask = Kernel::intersect(node, prepared, closestT, distances);
+		RT_STAT(nodesVisited, 1);
+		RT_STAT(boxTests, WIDTH);
+
+		// order the slots that were hit from near to far
+		std::array<int, WIDTH> hits;
+		int hitCount = 0;
+
+		for (int i = 0; i < WIDTH; i++)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+
+			int j = hitCount++;
+			for (; j > 0 && distances[hits[j - 1]] > distances[i]; j--)
+			{
+				hits[j] = hits[j - 1];
+			}
+			hits[j] = i;
+		}
+
+		// leaves are intersected straight away so closestT shrinks before the interior children are pushed
+		for (int k = 0; k < hitCount; k++)
+		{
+			int i = hits[k];
+			if (node.count[i] == 0 || distances[i] >= closestT)
+				continue;
+
+			RT_STAT(primitiveTests, node.count[i]);
+			int primitive = spheres.intersect(ray, node.offset[i], node.count[i], tMin, closestT, instancePrimitive);
+			if (primitive >= 0)
+			{
+				closestPrimitive = primitive;
+			}
+		}
+
+		// push the farthest first so the nearest is popped next
+		for (int k = hitCount - 1; k >= 0; k--)
+		{
+			int i = hits[k];
+			if (node.count[i] == 0 && distances[i] < closestT)
+			{
+				stack[stackSize++] = { distances[i], node.offset[i] };
+			}
+		}
+	}
+
+	return closestPrimitive;
+}
+
+template <int WIDTH>
+template <typename Kernel>
+bool WideBVH<WIDTH>::traverse_any(const ray& ray, const sphere_set& spheres, float tMin, float tMax) const
+{
+	// any hit will do, so the interval never shrinks and the slots are visited in storage order
+	std::array<uint32_t, MAX_STACK_SIZE> stack;
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	prepared_ray prepared = prepare(ray);
+
+	alignas(32) float distances[WIDTH];
+
+	while (stackSize > 0)
+	{
+		const WideBVHNode<WIDTH>& node = nodes[stack[--stackSize]];
+		int mask = Kernel::intersect(node, prepared, tMax, distances);
+		RT_STAT(nodesVisited, 1);
+		RT_STAT(boxTests, WIDTH);
+
+		for (int i = 0; mask; i++, mask >>= 1)
+		{
+			if (!(mask & 1))
+				continue;
+
+			if (node.count[i] == 0)
+			{
+				stack[stackSize++] = node.offset[i];
+				continue;
+			}
+
+			RT_STAT(primitiveTests, node.count[i]);
+			if (spheres.occluded(ray, node.offset[i], node.count[i], tMin, tMax))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
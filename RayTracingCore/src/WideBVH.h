@@ -0,0 +1,74 @@
+#pragma once
+#include "BVH.h"
+#include "simd.h"
+#include "sphere_set.h"
+
+// Node of a BVH with up to WIDTH children whose boxes are stored as structure of arrays,
+// so one ray is tested against all of them with a single vector kernel.
+// A slot with count == 0 references the interior node `offset`, otherwise it is a leaf covering
+// BVH::object_indices[offset, offset + count). Unused slots hold inverted boxes that never hit.
+template <int WIDTH>
+struct alignas(64) WideBVHNode
+{
+	float min_x[WIDTH];
+	float min_y[WIDTH];
+	float min_z[WIDTH];
+	float max_x[WIDTH];
+	float max_y[WIDTH];
+	float max_z[WIDTH];
+
+	uint32_t offset[WIDTH];
+	uint32_t count[WIDTH];
+};
+
+// Collapses a built BVH into WIDTH-wide nodes. BVH4 is traversed with SSE and BVH8 with AVX2,
+// both fall back to a scalar kernel when the CPU doesn't support them.
+template <int WIDTH>
+class WideBVH
+{
+public:
+	std::vector<WideBVHNode<WIDTH>> nodes;
+
+	// each level leaves at most WIDTH - 1 siblings on the stack and is at most as deep as the source tree
+	static constexpr int MAX_STACK_SIZE{ BVH::MAX_DEPTH * (WIDTH - 1) + 1 };
+
+	WideBVH(const BVH& bvh, const primitive_list& objects);
+
+	// recomputes the boxes holding the dirty objects after BVH::refit
+	void refit(const BVH& bvh, const primitive_list& objects, const std::vector<int>& dirty_objects);
+
+	// closest hit in [tMin, closestT), returns the primitive index into spheres or -1 and narrows closestT.
+	// instancePrimitive is set as in sphere_set::intersect
+	int intersect(const ray& ray, const sphere_set& spheres, float tMin, float& closestT, int& instancePrimitive) const;
+
+	// true if anything is hit in [tMin, tMax), stops at the first hit found
+	bool occluded(const ray& ray, const sphere_set& spheres, float tMin, float tMax) const;
+
+	bool is_vectorised() const;
+
+private:
+	struct slot_reference
+	{
+		uint32_t node;
+		uint32_t slot;
+	};
+
+	std::vector<slot_reference> m_parents;		// slot in the parent node pointing at each node
+	std::vector<slot_reference> m_objectSlots;	// leaf slot holding each object
+
+	uint32_t emit(const BVH& bvh, const primitive_list& objects, std::vector<uint32_t> sources);
+
+	void set_slot(uint32_t node, uint32_t slot, const glm::vec3& min, const glm::vec3& max);
+	void node_bounds(uint32_t node, glm::vec3& min, glm::vec3& max) const;
+
+	void leaf_bounds(const BVH& bvh, const primitive_list& objects, uint32_t offset, uint32_t count, glm::vec3& min, glm::vec3& max) const;
+
+	template <typename Kernel>
+	int traverse(const ray& ray, const sphere_set& spheres, float tMin, float& closestT, int& instancePrimitive) const;
+
+	template <typename Kernel>
+	bool traverse_any(const ray& ray, const sphere_set& spheres, float tMin, float tMax) const;
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
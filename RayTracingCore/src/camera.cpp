@@ -0,0 +1,94 @@
+#include "camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+camera::camera(float verticalFOV, float nearClip, float farClip)
+	: m_VerticalFOV(verticalFOV), m_NearClip(nearClip), m_FarClip(farClip)
+{
+	m_ForwardDirection = glm::vec3(0, 0, -1);
+	m_Position = glm::vec3(0, 0, 0);
+}
+
+void camera::set_view(const glm::vec3& position, const glm::vec3& forwardDirection)
+{
+	m_Position = position;
+	m_ForwardDirection = glm::normalize(forwardDirection);
+
+	recalculate_view();
+}
+
+void camera::on_resize(uint32_t width, uint32_t height)
+{
+	if (width == m_ViewportWidth && height == m_ViewportHeight)
+		return;
+
+	m_ViewportWidth = width;
+	m_ViewportHeight = height;
+
+	recalculate_projection();
+}
+
+void camera::recalculate_projection()
+{
+	m_Projection = glm::perspectiveFov(glm::radians(m_VerticalFOV), (float)m_ViewportWidth, (float)m_ViewportHeight, m_NearClip, m_FarClip);
+	m_InverseProjection = glm::inverse(m_Projection);
+
+	recalculate_ray_basis();
+}
+
+void camera::recalculate_view()
+{
+	m_View = glm::lookAt(m_Position, m_Position + m_ForwardDirection, glm::vec3(0, 1, 0));
+	m_InverseView = glm::inverse(m_View);
+
+	recalculate_ray_basis();
+}
+
+glm::vec3 camera::getRayDirection(uint32_t x, uint32_t y, sampler& rng) const
+{
+	glm::vec2 jitter = rng.get_2d();
+	return getPixelDirection(x + jitter.x, y + jitter.y);
+}
+
+glm::vec3 camera::getPixelDirection(float u, float v) const
+{
+	// per component, two multiply-adds each, rather than leaving vec3 arithmetic to the vectoriser
+	glm::vec3 direction{
+		m_RayCorner.x + u * m_RayDx.x + v * m_RayDy.x,
+		m_RayCorner.y + u * m_RayDx.y + v * m_RayDy.y,
+		m_RayCorner.z + u * m_RayDx.z + v * m_RayDy.z };
+
+	return direction * (1.0f / glm::sqrt(glm::dot(direction, direction)));
+}
+
+bool camera::getPixelAt(const glm::vec3& direction, glm::vec2& pixel) const
+{
+	glm::vec3 scaled = m_PixelFromRay * direction;
+	if (scaled.z <= 0.0f)
+		return false;
+
+	pixel = glm::vec2(scaled.x, scaled.y) / scaled.z;
+	return true;
+}
+
+void camera::recalculate_ray_basis()
+{
+	if (m_ViewportWidth == 0 || m_ViewportHeight == 0)
+		return;
+
+	// the view is a rigid transform, so normalising after it gives the same direction as before
+	auto planePoint = [&](float u, float v)
+	{
+		// u, v in [0,1] across the viewport, mapped to screen space [-1,1] with y pointing up
+		glm::vec4 target = m_InverseProjection * glm::vec4(u * 2.0f - 1.0f, 1.0f - v * 2.0f, -1, 1);
+		return glm::vec3(m_InverseView * glm::vec4(glm::vec3(target) / target.w, 0)); // World space
+	};
+
+	// the projected point is affine in screen space, so three corners span the whole plane
+	glm::vec3 topLeft = planePoint(0.0f, 0.0f);
+
+	m_RayCorner = topLeft;
+	m_RayDx = (planePoint(1.0f, 0.0f) - topLeft) / (float)m_ViewportWidth;
+	m_RayDy = (planePoint(0.0f, 1.0f) - topLeft) / (float)m_ViewportHeight;
+	m_PixelFromRay = glm::inverse(glm::mat3(m_RayDx, m_RayDy, m_RayCorner));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "sampler.h"
+
+class camera
+{
+public:
+	camera(float verticalFOV, float nearClip, float farClip);
+
+	// moves the camera to position, looking along forwardDirection with y up
+	void set_view(const glm::vec3& position, const glm::vec3& forwardDirection);
+	void on_resize(uint32_t width, uint32_t height);
+
+	const glm::mat4& get_projection() const { return m_Projection; }
+	const glm::mat4& get_inverse_projection() const { return m_InverseProjection; }
+	const glm::mat4& get_view() const { return m_View; }
+	const glm::mat4& get_inverse_view() const { return m_InverseView; }
+	
+	const glm::vec3& getPosition() const { return m_Position; }
+	const glm::vec3& get_direction() const { return m_ForwardDirection; }
+	glm::vec3 getRayDirection(uint32_t x, uint32_t y, sampler& rng) const;
+
+	// normalised direction through a point of the viewport in pixel coordinates, pixel centres are at .5
+	glm::vec3 getPixelDirection(float u, float v) const;
+
+	// where a world space direction from the camera's position crosses the viewport in pixel coordinates,
+	// false if it points away from the image plane
+	bool getPixelAt(const glm::vec3& direction, glm::vec2& pixel) const;
+
+	// same position, direction and projection
+	bool hasSameView(const camera& other) const { return m_View == other.m_View && m_Projection == other.m_Projection; }
+
+private:
+	void recalculate_projection();
+	void recalculate_view();
+	void recalculate_ray_basis();
+private:
+	glm::mat4 m_Projection{ 1.0f };
+	glm::mat4 m_View{ 1.0f }; // world-to-camera matrix
+	glm::mat4 m_InverseProjection{ 1.0f };
+	glm::mat4 m_InverseView{ 1.0f }; // camera-to-world matrix
+
+	float m_VerticalFOV = 45.0f;
+	float m_NearClip = 0.1f;
+	float m_FarClip = 100.0f;
+
+	glm::vec3 m_Position{0.0f, 0.0f, 0.0f};
+	glm::vec3 m_ForwardDirection{0.0f, 0.0f, 0.0f};
+
+	// World space image plane: the unnormalised direction through pixel coordinate (x, y) is
+	// m_RayCorner + x * m_RayDx + y * m_RayDy, rebuilt whenever the view or projection changes
+	glm::vec3 m_RayCorner{ 0.0f, 0.0f, -1.0f };
+	glm::vec3 m_RayDx{ 0.0f };
+	glm::vec3 m_RayDy{ 0.0f };
+	glm::mat3 m_PixelFromRay{ 1.0f }; // inverse of the basis above, (u, v, 1) scaled by the distance to the plane
+
+	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
+};
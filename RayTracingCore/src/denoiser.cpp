@@ -0,0 +1,167 @@
+#include "denoiser.h"
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+namespace
+{
+	// B3 spline, the 5x5 kernel is its outer product
+	constexpr float KERNEL[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+	// black albedo would divide by zero, such channels are filtered as plain colour instead
+	constexpr float MIN_ALBEDO{ 0.01f };
+	constexpr float MIN_DEPTH{ 1e-4f };
+	constexpr float MIN_SIGMA{ 1e-6f };
+	constexpr int MAX_ITERATIONS{ 16 };
+
+	// what the colour is divided by to leave the lighting, and multiplied by again afterwards
+	glm::vec3 getDemodulation(const glm::vec3& albedo)
+	{
+		return {
+			albedo.r < MIN_ALBEDO ? 1.0f : albedo.r,
+			albedo.g < MIN_ALBEDO ? 1.0f : albedo.g,
+			albedo.b < MIN_ALBEDO ? 1.0f : albedo.b
+		};
+	}
+}
+
+void denoiser::run(const std::vector<glm::vec4>& colour, const std::vector<uint32_t>& samples, const std::vector<framebuffer::aov>& aovs,
+	uint32_t width, uint32_t height, const settings& settings, std::vector<glm::vec4>& filtered)
+{
+	size_t size = (size_t)width * height;
+	m_lighting.resize(size);
+	m_next.resize(size);
+	m_normalX.resize(size);
+	m_normalY.resize(size);
+	m_normalZ.resize(size);
+	m_depth.resize(size);
+	m_depthScale.resize(size);
+	m_colourScale.resize(size);
+
+	float depthSigma = std::max(settings.depthSigma, MIN_SIGMA);
+	float colourSigma = std::max(settings.colourSigma, MIN_SIGMA);
+	float colourScale = 1.0f / (colourSigma * colourSigma);
+	for (size_t i = 0; i < size; i++)
+	{
+		const framebuffer::aov& aov = aovs[i];
+		glm::vec3 albedo = getDemodulation(aov.albedo);
+
+		m_lighting.r[i] = colour[i].r / albedo.r;
+		m_lighting.g[i] = colour[i].g / albedo.g;
+		m_lighting.b[i] = colour[i].b / albedo.b;
+
+		m_normalX[i] = aov.normal.x;
+		m_normalY[i] = aov.normal.y;
+		m_normalZ[i] = aov.normal.z;
+		m_depth[i] = aov.depth;
+		m_depthScale[i] = 1.0f / (depthSigma * std::max(aov.depth, MIN_DEPTH));
+
+		// the variance of a mean falls with its samples, a pixel that has none yet is as noisy as one sample
+		m_colourScale[i] = colourScale * (float)std::max(samples[i], 1u);
+	}
+
+	m_rows.resize(height);
+	std::iota(m_rows.begin(), m_rows.end(), 0u);
+
+	float normalSigma = std::max(settings.normalSigma, MIN_SIGMA);
+	float normalScale = 1.0f / (normalSigma * normalSigma);
+
+	int iterations = std::clamp(settings.iterations, 0, MAX_ITERATIONS);
+	for (int pass = 0; pass < iterations; pass++)
+	{
+		// later passes average pixels further apart, so they need colours to be closer to trust them.
+		// Halving the sigma every pass quarters the variance
+		float passScale = (float)(1u << (2 * pass));
+
+		std::for_each(std::execution::par, m_rows.begin(), m_rows.end(), [&](uint32_t y)
+		{
+			filter_row(y, width, height, 1 << pass, passScale, normalScale);
+		});
+
+		std::swap(m_lighting, m_next);
+	}
+
+	filtered.resize(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		glm::vec3 albedo = getDemodulation(aovs[i].albedo);
+		filtered[i] = glm::vec4(m_lighting.r[i] * albedo.r, m_lighting.g[i] * albedo.g, m_lighting.b[i] * albedo.b, colour[i].a);
+	}
+}
+
+void denoiser::filter_row(uint32_t y, uint32_t width, uint32_t height, int step, float passScale, float normalScale)
+{
+	// reused by every row this thread filters
+	thread_local std::vector<float> sumR, sumG, sumB, sumWeight;
+	sumR.assign(width, 0.0f);
+	sumG.assign(width, 0.0f);
+	sumB.assign(width, 0.0f);
+	sumWeight.assign(width, 0.0f);
+
+	const float* r = m_lighting.r.data();
+	const float* g = m_lighting.g.data();
+	const float* b = m_lighting.b.data();
+	const float* normalX = m_normalX.data();
+	const float* normalY = m_normalY.data();
+	const float* normalZ = m_normalZ.data();
+	const float* depth = m_depth.data();
+	const float* depthScale = m_depthScale.data();
+	const float* colourScale = m_colourScale.data();
+	size_t row = (size_t)y * width;
+
+	for (int j = -2; j <= 2; j++)
+	{
+		int tapY = (int)y + j * step;
+		if (tapY < 0 || tapY >= (int)height)
+			continue;
+
+		size_t tapRow = (size_t)tapY * width;
+
+		for (int i = -2; i <= 2; i++)
+		{
+			int dx = i * step;
+			float kernel = KERNEL[j + 2] * KERNEL[i + 2];
+
+			// depth may change in proportion to how far apart the taps are, a slanted plane keeps its weight
+			float tapDistance = std::max(std::sqrt((float)(dx * dx + j * step * j * step)), 1.0f);
+			float tapScale = 1.0f / tapDistance;
+
+			// taps outside the image are left out rather than clamped, the weights are normalised anyway
+			int begin = std::max(0, -dx);
+			int end = std::min((int)width, (int)width - dx);
+
+			for (int x = begin; x < end; x++)
+			{
+				size_t p = row + x;
+				size_t q = tapRow + x + dx;
+
+				float dr = r[q] - r[p];
+				float dg = g[q] - g[p];
+				float db = b[q] - b[p];
+				float dnx = normalX[q] - normalX[p];
+				float dny = normalY[q] - normalY[p];
+				float dnz = normalZ[q] - normalZ[p];
+
+				float distance = (dr * dr + dg * dg + db * db) * colourScale[p] * passScale
+					+ (dnx * dnx + dny * dny + dnz * dnz) * normalScale
+					+ std::abs(depth[q] - depth[p]) * depthScale[p] * tapScale;
+				float weight = kernel * std::exp(-distance);
+
+				sumR[x] += weight * r[q];
+				sumG[x] += weight * g[q];
+				sumB[x] += weight * b[q];
+				sumWeight[x] += weight;
+			}
+		}
+	}
+
+	// the centre tap always has full weight, so no sum is zero
+	for (uint32_t x = 0; x < width; x++)
+	{
+		float inverse = 1.0f / sumWeight[x];
+		m_next.r[row + x] = sumR[x] * inverse;
+		m_next.g[row + x] = sumG[x] * inverse;
+		m_next.b[row + x] = sumB[x] * inverse;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "framebuffer.h"
+#include <cstdint>
+#include <vector>
+
+// Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010) for low sample count images. Each pass blurs
+// with a 5x5 B3 spline kernel whose taps are 2^pass pixels apart, so a few passes cover a wide footprint
+// for 25 taps each, and every tap is weighted down across edges in the first hit's normal and depth and in
+// the colour, more strictly every pass. The colour is divided by the albedo first, so only the lighting is
+// blurred and material edges come back sharp when it is multiplied in again.
+// The image is kept as planes of one float per pixel and a row is filtered one tap at a time over
+// contiguous runs, which the compiler vectorises. Rows are filtered in parallel.
+class denoiser
+{
+public:
+	struct settings
+	{
+		int iterations{ 4 };		// passes, the last one's taps are 2^(iterations - 1) pixels apart
+		float colourSigma{ 2.0f };	// of the lighting at one sample, divided by the square root of a pixel's samples and halved every pass
+		float normalSigma{ 0.3f };
+		float depthSigma{ 0.02f };	// relative change in depth allowed per pixel of distance between taps
+	};
+
+	// filters the noisy linear colour of a width by height image guided by its AOVs, alpha is passed through.
+	// samples holds how many samples each pixel averages, which sets how much noise its colour is expected to have
+	void run(const std::vector<glm::vec4>& colour, const std::vector<uint32_t>& samples, const std::vector<framebuffer::aov>& aovs,
+		uint32_t width, uint32_t height, const settings& settings, std::vector<glm::vec4>& filtered);
+
+private:
+	struct planes
+	{
+		std::vector<float> r;
+		std::vector<float> g;
+		std::vector<float> b;
+
+		void resize(size_t size)
+		{
+			r.resize(size);
+			g.resize(size);
+			b.resize(size);
+		}
+	};
+
+	planes m_lighting{};
+	planes m_next{};
+
+	// guides, the depth and colour scales are already divided through so a tap only multiplies: 1 / (depthSigma * depth)
+	// and samples / colourSigma^2, the centre pixel's inverse colour variance for the first pass
+	std::vector<float> m_normalX{};
+	std::vector<float> m_normalY{};
+	std::vector<float> m_normalZ{};
+	std::vector<float> m_depth{};
+	std::vector<float> m_depthScale{};
+	std::vector<float> m_colourScale{};
+
+	std::vector<uint32_t> m_rows{};
+
+	void filter_row(uint32_t y, uint32_t width, uint32_t height, int step, float passScale, float normalScale);
+};
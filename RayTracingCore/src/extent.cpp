@@ -44,6 +44,32 @@ float extent::hit(const ray& ray) const
 	return t_near;
 }
 
+extent extent::from_aabb(const glm::vec3& min, const glm::vec3& max)
+{
+	extent aabb{};
+	for (int i = 0; i < 3; i++)
+	{
+		aabb.slabs[i] = { min[i], max[i] };
+		aabb.active.set(i);
+	}
+
+	return aabb;
+}
+
+float extent::surface_area() const
+{
+	glm::vec3 size{ 0.0f };
+	for (int i = 0; i < 3; i++)
+	{
+		if (active[i])
+		{
+			size[i] = glm::max(0.0f, slabs[i].d_far - slabs[i].d_near);
+		}
+	}
+
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
 void extent::expand(const extent& other)
 {
 	for (size_t i = 0; i < 7; i++)
@@ -30,8 +30,14 @@ public:
 	std::bitset<7> active{};
 
 	extent() {}
+
+	// axis-aligned box over the first three slabs
+	static extent from_aabb(const glm::vec3& min, const glm::vec3& max);
 	
 	void expand(const extent& other);
 
+	// surface area of the axis-aligned slabs, used for SAH cost estimates
+	float surface_area() const;
+
 	float hit(const ray& ray) const;
 };
\ No newline at end of file
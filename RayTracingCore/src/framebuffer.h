@@ -0,0 +1,52 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// CPU image the renderer resolves every frame into. Each pixel keeps the linear average of its samples
+// for HDR output and the clamped 8 bit RGBA value that is displayed or written as PNG, along with the
+// average of what its samples' first hits saw, which guides the denoiser.
+class framebuffer
+{
+public:
+	// first hit buffers, a ray that escaped leaves white albedo, a zero normal and zero depth
+	struct aov
+	{
+		glm::vec3 albedo{ 1.0f };
+		glm::vec3 normal{ 0.0f };
+		float depth{ 0.0f };
+	};
+
+	void resize(uint32_t width, uint32_t height)
+	{
+		m_width = width;
+		m_height = height;
+		m_colour.assign((size_t)width * height, glm::vec4(0.0f));
+		m_rgba.assign((size_t)width * height, 0);
+		m_aovs.assign((size_t)width * height, aov{});
+	}
+
+	uint32_t get_width() const { return m_width; }
+	uint32_t get_height() const { return m_height; }
+	size_t size() const { return m_rgba.size(); }
+
+	const std::vector<glm::vec4>& get_colour() const { return m_colour; }
+	const std::vector<uint32_t>& get_rgba() const { return m_rgba; }
+	const std::vector<aov>& get_aovs() const { return m_aovs; }
+
+	void set_pixel(uint32_t index, const glm::vec4& colour, uint32_t rgba)
+	{
+		m_colour[index] = colour;
+		m_rgba[index] = rgba;
+	}
+
+	void set_aov(uint32_t index, const aov& value) { m_aovs[index] = value; }
+
+private:
+	uint32_t m_width{ 0 };
+	uint32_t m_height{ 0 };
+
+	std::vector<glm::vec4> m_colour{};
+	std::vector<uint32_t> m_rgba{}; // R in the lowest byte
+	std::vector<aov> m_aovs{};
+};
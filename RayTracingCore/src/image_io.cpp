@@ -0,0 +1,149 @@
+#include "image_io.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+namespace
+{
+	uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> table{};
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				table[n] = c;
+			}
+			return table;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void put_u32(std::vector<uint8_t>& out, uint32_t v)
+	{
+		out.push_back((uint8_t)(v >> 24));
+		out.push_back((uint8_t)(v >> 16));
+		out.push_back((uint8_t)(v >> 8));
+		out.push_back((uint8_t)v);
+	}
+
+	void put_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+	{
+		put_u32(out, (uint32_t)data.size());
+
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+
+		put_u32(out, crc32(out.data() + start, out.size() - start));
+	}
+}
+
+bool image_io::write_png(const framebuffer& image, const std::string& path)
+{
+	uint32_t width = image.get_width();
+	uint32_t height = image.get_height();
+	const std::vector<uint32_t>& rgba = image.get_rgba();
+
+	// every scanline starts with filter type 0, pixels are stored as R, G, B, A bytes
+	std::vector<uint8_t> raw;
+	raw.reserve((size_t)height * (1 + 4 * (size_t)width));
+	for (uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t pixel = rgba[(size_t)y * width + x];
+			raw.push_back((uint8_t)pixel);
+			raw.push_back((uint8_t)(pixel >> 8));
+			raw.push_back((uint8_t)(pixel >> 16));
+			raw.push_back((uint8_t)(pixel >> 24));
+		}
+	}
+
+	// zlib stream of stored (uncompressed) deflate blocks, renders are written once so size isn't a concern
+	std::vector<uint8_t> compressed{ 0x78, 0x01 };
+	uint32_t a = 1, b = 0;
+	for (size_t offset = 0; offset < raw.size() || offset == 0;)
+	{
+		size_t length = std::min<size_t>(raw.size() - offset, 65535);
+		bool last = offset + length == raw.size();
+
+		compressed.push_back(last ? 1 : 0);
+		compressed.push_back((uint8_t)length);
+		compressed.push_back((uint8_t)(length >> 8));
+		compressed.push_back((uint8_t)~length);
+		compressed.push_back((uint8_t)(~length >> 8));
+		compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + length);
+
+		for (size_t i = offset; i < offset + length; i++)
+		{
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		offset += length;
+		if (last)
+			break;
+	}
+	put_u32(compressed, b << 16 | a);
+
+	std::vector<uint8_t> header;
+	put_u32(header, width);
+	put_u32(header, height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bit RGBA, no interlacing
+
+	std::vector<uint8_t> file{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	put_chunk(file, "IHDR", header);
+	put_chunk(file, "IDAT", compressed);
+	put_chunk(file, "IEND", {});
+
+	std::ofstream stream(path, std::ios::binary);
+	stream.write((const char*)file.data(), file.size());
+	return (bool)stream;
+}
+
+bool image_io::write_pfm(const framebuffer& image, const std::string& path)
+{
+	uint32_t width = image.get_width();
+	uint32_t height = image.get_height();
+	const std::vector<glm::vec4>& colour = image.get_colour();
+
+	std::ofstream stream(path, std::ios::binary);
+
+	// a negative scale marks little endian data
+	stream << "PF\n" << width << " " << height << "\n-1.0\n";
+
+	std::vector<float> row(3 * (size_t)width);
+	for (uint32_t y = height; y-- > 0;)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const glm::vec4& pixel = colour[(size_t)y * width + x];
+			row[3 * x + 0] = pixel.r;
+			row[3 * x + 1] = pixel.g;
+			row[3 * x + 2] = pixel.b;
+		}
+		stream.write((const char*)row.data(), row.size() * sizeof(float));
+	}
+
+	return (bool)stream;
+}
+
+bool image_io::write(const framebuffer& image, const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+
+	if (extension == ".pfm" || extension == ".PFM")
+		return write_pfm(image, path);
+
+	return write_png(image, path);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "framebuffer.h"
+#include <string>
+
+// Writes a framebuffer to disk, these return false if the file can't be written.
+namespace image_io
+{
+	// 8 bit RGBA, as displayed
+	bool write_png(const framebuffer& image, const std::string& path);
+
+	// linear 32 bit float RGB, bottom row first as the format expects
+	bool write_pfm(const framebuffer& image, const std::string& path);
+
+	// picks the format from the extension, PNG unless it is .pfm
+	bool write(const framebuffer& image, const std::string& path);
+}
@@ -0,0 +1,135 @@
+#include "instance.h"
+
+instance_geometry::instance_geometry(std::vector<std::unique_ptr<object>> objects, std::vector<std::unique_ptr<triangle_mesh>> meshes, const BVH::build_settings& settings)
+	: m_objects(std::move(objects)), m_meshes(std::move(meshes))
+{
+	m_primitives = primitive_list(m_objects, m_meshes);
+	if (m_primitives.size() == 0)
+		return;
+
+	m_bvh = std::make_unique<BVH>(m_primitives, settings);
+	m_spheres.build(*m_bvh, m_primitives);
+
+	BVH::node_layout layout = BVH::resolve_layout(settings.layout);
+	if (layout == BVH::node_layout::bvh4)
+		m_bvh4 = std::make_unique<BVH4>(*m_bvh, m_primitives);
+	else if (layout == BVH::node_layout::bvh8)
+		m_bvh8 = std::make_unique<BVH8>(*m_bvh, m_primitives);
+
+	for (uint32_t p = 0; p < m_primitives.size(); p++)
+	{
+		extent aabb = m_primitives.get_extent(p, { 0,1,2 });
+		m_min = glm::min(m_min, glm::vec3(aabb.slabs[0].d_near, aabb.slabs[1].d_near, aabb.slabs[2].d_near));
+		m_max = glm::max(m_max, glm::vec3(aabb.slabs[0].d_far, aabb.slabs[1].d_far, aabb.slabs[2].d_far));
+	}
+}
+
+int instance_geometry::intersect(const ray& ray, float tMin, float& closestT) const
+{
+	if (!m_bvh)
+		return -1;
+
+	// the geometry holds no instances of its own
+	int instancePrimitive;
+	if (m_bvh8)
+		return m_bvh8->intersect(ray, m_spheres, tMin, closestT, instancePrimitive);
+	if (m_bvh4)
+		return m_bvh4->intersect(ray, m_spheres, tMin, closestT, instancePrimitive);
+	return m_bvh->intersect(ray, m_spheres, tMin, closestT, instancePrimitive);
+}
+
+bool instance_geometry::occluded(const ray& ray, float tMin, float tMax) const
+{
+	if (!m_bvh)
+		return false;
+
+	if (m_bvh8)
+		return m_bvh8->occluded(ray, m_spheres, tMin, tMax);
+	if (m_bvh4)
+		return m_bvh4->occluded(ray, m_spheres, tMin, tMax);
+	return m_bvh->occluded(ray, m_spheres, tMin, tMax);
+}
+
+glm::vec3 instance_geometry::getNormalAt(int primitive, const glm::vec3& position, const glm::vec3& direction) const
+{
+	return m_spheres.normal(primitive, position, direction);
+}
+
+instance::instance(std::shared_ptr<const instance_geometry> geometry, const glm::vec3& position, int material_index)
+	: geometry(std::move(geometry)), position(position), material_index(material_index)
+{
+}
+
+void instance::set_basis(const glm::mat3& basis)
+{
+	m_basis = basis;
+	m_inverse = glm::inverse(basis);
+}
+
+ray instance::to_object_space(const ray& ray) const
+{
+	return { m_inverse * (ray.origin - position), m_inverse * ray.direction };
+}
+
+extent instance::get_extent(const std::vector<int>& normal_indices) const
+{
+	std::array<glm::vec3, 8> corners;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner{
+			(i & 1) ? geometry->get_max().x : geometry->get_min().x,
+			(i & 2) ? geometry->get_max().y : geometry->get_min().y,
+			(i & 4) ? geometry->get_max().z : geometry->get_min().z };
+		corners[i] = position + m_basis * corner;
+	}
+
+	extent extent{};
+	for (int normal_index : normal_indices)
+	{
+		const glm::vec3& normal = extent::plane_set_normals[normal_index];
+
+		float d_near = FLT_MAX;
+		float d_far = -FLT_MAX;
+		for (const glm::vec3& corner : corners)
+		{
+			float d = glm::dot(corner, normal);
+			d_near = std::min(d_near, d);
+			d_far = std::max(d_far, d);
+		}
+
+		extent.slabs[normal_index] = { d_near, d_far };
+		extent.active.set(normal_index);
+	}
+
+	return extent;
+}
+
+glm::vec3 instance::get_centre() const
+{
+	return position + m_basis * (0.5f * (geometry->get_min() + geometry->get_max()));
+}
+
+float instance::hit(const ray& ray, float tMin, float tMax, int& primitive) const
+{
+	float closestT = tMax;
+	primitive = geometry->intersect(to_object_space(ray), tMin, closestT);
+	return primitive >= 0 ? closestT : -1.0f;
+}
+
+bool instance::occluded(const ray& ray, float tMin, float tMax) const
+{
+	return geometry->occluded(to_object_space(ray), tMin, tMax);
+}
+
+glm::vec3 instance::getNormalAt(const ray& ray, int primitive, float hitDistance) const
+{
+	if (primitive < 0)
+		return -glm::normalize(ray.direction);
+
+	// distances along the ray are the same in both spaces
+	::ray local = to_object_space(ray);
+	glm::vec3 normal = geometry->getNormalAt(primitive, local.origin + hitDistance * local.direction, local.direction);
+
+	// normals go back through the inverse transpose so they stay perpendicular under non-uniform scale
+	return glm::normalize(glm::transpose(m_inverse) * normal);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "BVH.h"
+#include "WideBVH.h"
+#include "sphere_set.h"
+#include <memory>
+
+// Geometry shared by any number of instances: objects and meshes in their own object space with a
+// bottom-level BVH built once, when the geometry is made. Instances only refer to it, so a thousand
+// copies cost a thousand transforms and not a thousand copies of the triangles and their tree.
+class instance_geometry
+{
+public:
+	instance_geometry(std::vector<std::unique_ptr<object>> objects, std::vector<std::unique_ptr<triangle_mesh>> meshes, const BVH::build_settings& settings);
+
+	// the BVH and packed leaves point into the geometry's own containers, so it stays where it was made
+	instance_geometry(const instance_geometry&) = delete;
+	instance_geometry& operator=(const instance_geometry&) = delete;
+
+	// closest hit in [tMin, closestT) of an object space ray, returns the primitive index into the packed leaves or -1 and narrows closestT
+	int intersect(const ray& ray, float tMin, float& closestT) const;
+
+	// true if anything is hit in [tMin, tMax), stops at the first hit found
+	bool occluded(const ray& ray, float tMin, float tMax) const;
+
+	// object space normal of a primitive intersect() returned
+	glm::vec3 getNormalAt(int primitive, const glm::vec3& position, const glm::vec3& direction) const;
+
+	size_t primitive_count() const { return m_primitives.size(); }
+	size_t triangle_count() const { return m_primitives.size() - m_primitives.object_count(); }
+	const BVH& get_bvh() const { return *m_bvh; }
+
+	// object space box around every primitive
+	const glm::vec3& get_min() const { return m_min; }
+	const glm::vec3& get_max() const { return m_max; }
+
+private:
+	std::vector<std::unique_ptr<object>> m_objects;
+	std::vector<std::unique_ptr<triangle_mesh>> m_meshes;
+	primitive_list m_primitives;
+
+	std::unique_ptr<BVH> m_bvh;
+	std::unique_ptr<BVH4> m_bvh4;
+	std::unique_ptr<BVH8> m_bvh8;
+	sphere_set m_spheres;
+
+	glm::vec3 m_min{ FLT_MAX };
+	glm::vec3 m_max{ -FLT_MAX };
+};
+
+// One placement of shared geometry. The scene's BVH is built over instance bounds as the top level,
+// and a ray that reaches an instance leaf is moved into object space to traverse the geometry's own
+// BVH. Moving an instance therefore refits or rebuilds the scene's BVH only, never the geometry's.
+class instance
+{
+public:
+	std::shared_ptr<const instance_geometry> geometry;
+	glm::vec3 position{ 0.0f };
+
+	// every primitive of the geometry is shaded with it, the geometry's own materials are ignored
+	int material_index{ 0 };
+
+	instance(std::shared_ptr<const instance_geometry> geometry, const glm::vec3& position, int material_index = 0);
+
+	// rotation and scale, the columns are the object axes in world space. Must be invertible
+	const glm::mat3& get_basis() const { return m_basis; }
+	void set_basis(const glm::mat3& basis);
+
+	extent get_extent(const std::vector<int>& normal_indices) const;
+
+	// centre of the geometry's box in world space
+	glm::vec3 get_centre() const;
+
+	// distance along the world space ray to the closest hit in [tMin, tMax), -1 on a miss. primitive is set
+	// to the geometry's primitive that was hit, for getNormalAt
+	float hit(const ray& ray, float tMin, float tMax, int& primitive) const;
+
+	bool occluded(const ray& ray, float tMin, float tMax) const;
+
+	// world space normal where the ray hit the geometry's primitive, hitDistance along the ray
+	glm::vec3 getNormalAt(const ray& ray, int primitive, float hitDistance) const;
+
+private:
+	glm::mat3 m_basis{ 1.0f };
+	glm::mat3 m_inverse{ 1.0f };
+
+	// the direction is transformed but not normalised, so distances along the ray match in both spaces
+	ray to_object_space(const ray& ray) const;
+};
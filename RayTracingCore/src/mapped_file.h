@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped when destroyed.
+class mapped_file
+{
+public:
+	mapped_file() = default;
+	~mapped_file() { close(); }
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+
+	const void* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const void* m_data{};
+	size_t m_size{ 0 };
+
+#ifdef _WIN32
+	void* m_file{};
+	void* m_mapping{};
+#endif
+};
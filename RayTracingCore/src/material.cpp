@@ -1,63 +1,74 @@
 #include "material.h"
 #include "BRDF.h"
-#include "Random.h"
 #include <glm/gtc/constants.hpp>
-#include <random>
-#include <Walnut/Random.h>
 #include <iostream>
 
-bool material::scatter(const ray& rayIn, ray& rayOut, const hit_info& hitInfo, float& pdf) const
+bool material::scatter(const ray& rayIn, ray& rayOut, const hit_info& hitInfo, float& pdf, sampler& rng) const
 {
 	glm::vec3 viewDirection = glm::normalize(-rayIn.direction);
 
-	glm::vec3 F0 = glm::mix(glm::vec3(0.08f * specular), baseColour, metallic);
-
 	float dotNV = glm::max(0.0f, glm::dot(hitInfo.worldNormal, viewDirection));
-	glm::vec3 fVec = BRDF::fresnelSchlick(dotNV, F0);
-	float F = (fVec.r + fVec.g + fVec.b) / 3.0f;
+	float specularChance = getSpecularChance(dotNV);
 
-	float specularWeight = F;
-	float diffuseWeight = (1.0f - F) * (1.0f - metallic);
-	float totalWeight = specularWeight + diffuseWeight;
-
-	float specularChance = specularWeight / totalWeight;
-	float diffuseChance = diffuseWeight / totalWeight;
-
-	if (Random::getReal(0.0f, 1.0f) < specularChance)
+	glm::vec3 lightDirection;
+	if (rng.get_real() < specularChance)
 	{
 		// specular lobe
-		glm::vec3 halfVector = getHalfVector(hitInfo.worldNormal, viewDirection);
-		glm::vec3 lightDirection = glm::reflect(-viewDirection, halfVector);
+		glm::vec3 halfVector = getHalfVector(hitInfo.worldNormal, viewDirection, rng);
+		lightDirection = glm::reflect(-viewDirection, halfVector);
 
 		float dotNL = glm::dot(hitInfo.worldNormal, lightDirection);
 		if (dotNL <= 0.0f) return false;
+	}
+	else
+	{
+		// diffuse lobe, normal plus a uniform direction on the sphere is cosine distributed
+		lightDirection = glm::normalize(hitInfo.worldNormal + rng.on_unit_sphere());
+	}
 
-		rayOut = { hitInfo.worldPosition + 0.001f * hitInfo.worldNormal, lightDirection };
+	rayOut.origin = hitInfo.worldPosition + 0.001f * hitInfo.worldNormal;
+	rayOut.direction = glm::normalize(lightDirection);
 
-		float dotNH = glm::max(0.0f, glm::dot(hitInfo.worldNormal, halfVector));
-		float dotLH = glm::max(0.0f, glm::dot(lightDirection, halfVector));
-		dotNV = glm::max(1e-5f, dotNV);
+	// either lobe could have produced the direction, so the estimate divides by the mixture of both
+	pdf = this->pdf(viewDirection, rayOut.direction, hitInfo.worldNormal);
 
-		float D = BRDF::distributionGGX(dotNH, roughness);
-		float G1 = BRDF::geometrySchlickGGXG1(dotNV, roughness * roughness);
+	return pdf > 0.0f;
+}
 
-		float specPDF = (D * G1) / (4.0f * dotNV);
-		pdf = specPDF * specularChance;
-	}
-	else
-	{
-		// diffuse lobe
-		glm::vec3 lightDirection = glm::normalize(hitInfo.worldNormal + Walnut::Random::InUnitSphere());
+float material::pdf(const glm::vec3& viewDirection, const glm::vec3& lightDirection, const glm::vec3& normal) const
+{
+	float dotNL = glm::dot(normal, lightDirection);
+	if (dotNL <= 0.0f)
+		return 0.0f;
 
-		rayOut.origin = hitInfo.worldPosition + 0.001f * hitInfo.worldNormal;
-		rayOut.direction = glm::normalize(lightDirection);
+	float dotNV = glm::max(0.0f, glm::dot(normal, viewDirection));
+	float specularChance = getSpecularChance(dotNV);
 
-		float cosTheta = glm::dot(hitInfo.worldNormal, rayOut.direction);
-		float diffusePDF = cosTheta * glm::one_over_pi<float>();
-		pdf = diffusePDF * diffuseChance;
-	}
+	// visible normal sampling, the reflection jacobian cancels down to D * G1 / (4 * dotNV)
+	glm::vec3 halfVector = glm::normalize(viewDirection + lightDirection);
+	float dotNH = glm::max(0.0f, glm::dot(normal, halfVector));
+	dotNV = glm::max(1e-5f, dotNV);
+
+	float D = BRDF::distributionGGX(dotNH, roughness);
+	float G1 = BRDF::geometrySchlickGGXG1(dotNV, roughness * roughness);
+
+	float specularPDF = (D * G1) / (4.0f * dotNV);
+	float diffusePDF = dotNL * glm::one_over_pi<float>();
+
+	return specularChance * specularPDF + (1.0f - specularChance) * diffusePDF;
+}
+
+float material::getSpecularChance(float dotNV) const
+{
+	glm::vec3 F0 = glm::mix(glm::vec3(0.08f * specular), baseColour, metallic);
+
+	glm::vec3 fVec = BRDF::fresnelSchlick(dotNV, F0);
+	float F = (fVec.r + fVec.g + fVec.b) / 3.0f;
+
+	float specularWeight = F;
+	float diffuseWeight = (1.0f - F) * (1.0f - metallic);
 
-	return true;
+	return specularWeight / (specularWeight + diffuseWeight);
 }
  
 glm::vec3 material::brdf(const glm::vec3& viewDirection, const glm::vec3& lightDirection, const glm::vec3& normal) const
@@ -91,10 +102,9 @@ glm::vec3 material::brdf(const glm::vec3& viewDirection, const glm::vec3& lightD
 	return diffuseComponent + specularComponent;
 }
 
-glm::vec3 material::getHalfVector(const glm::vec3& normal, const glm::vec3& viewDirection) const
+glm::vec3 material::getHalfVector(const glm::vec3& normal, const glm::vec3& viewDirection, sampler& rng) const
 {
-	float u1 = Random::getReal(0.0f, 1.0f);
-	float u2 = Random::getReal(0.0f, 1.0f);
+	glm::vec2 u = rng.get_2d();
 
-	return BRDF::sampleGGXVNDF(normal,viewDirection, roughness, u1, u2);
+	return BRDF::sampleGGXVNDF(normal,viewDirection, roughness, u.x, u.y);
 }
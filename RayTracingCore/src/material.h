@@ -1,6 +1,8 @@
 #pragma once
 #include "hit_info.h"
 #include "ray.h"
+#include "sampler.h"
+#include <memory>
 
 class material
 {
@@ -13,13 +15,22 @@ public:
 
 	virtual ~material() {}
 
-	virtual bool scatter(const ray& rayIn, ray& rayOut, const hit_info& hitInfo, float& pdf) const;
+	virtual bool scatter(const ray& rayIn, ray& rayOut, const hit_info& hitInfo, float& pdf, sampler& rng) const;
 
 	virtual glm::vec3 brdf(const glm::vec3& viewDirection, const glm::vec3& lightDirection, const glm::vec3& normal) const;
 
+	// density of scatter choosing lightDirection, per solid angle
+	virtual float pdf(const glm::vec3& viewDirection, const glm::vec3& lightDirection, const glm::vec3& normal) const;
+
 	virtual glm::vec3 emitted() const { return glm::vec3(0.0f); }
 
-	glm::vec3 getHalfVector(const glm::vec3& normal, const glm::vec3& viewDirection) const;
+	virtual std::unique_ptr<material> clone() const { return std::make_unique<material>(*this); }
+
+	glm::vec3 getHalfVector(const glm::vec3& normal, const glm::vec3& viewDirection, sampler& rng) const;
+
+private:
+	// probability of sampling the specular lobe, the diffuse lobe gets the rest
+	float getSpecularChance(float dotNV) const;
 
 };
 
@@ -28,10 +39,14 @@ class emissive : public material
 public:
 	float emissionStrength{ 1.0f };
 
-	bool scatter(const ray& rayIn, ray& rayOut, const hit_info& hitInfo, float& pdf) const override { return false; }
+	bool scatter(const ray& rayIn, ray& rayOut, const hit_info& hitInfo, float& pdf, sampler& rng) const override { return false; }
 
 	virtual glm::vec3 brdf(const glm::vec3& viewDirection, const glm::vec3& lightDirection, const glm::vec3& normal) const override { return glm::vec3(0.0f); }
 
+	virtual float pdf(const glm::vec3& viewDirection, const glm::vec3& lightDirection, const glm::vec3& normal) const override { return 0.0f; }
+
 	virtual glm::vec3 emitted() const override { return baseColour * emissionStrength; }
 
+	virtual std::unique_ptr<material> clone() const override { return std::make_unique<emissive>(*this); }
+
 };
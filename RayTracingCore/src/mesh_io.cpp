@@ -0,0 +1,992 @@
+#include "mesh_io.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <execution>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	// smaller chunks cost more to schedule than they save
+	constexpr size_t MIN_CHUNK_BYTES{ 1 << 20 };
+
+	size_t chunk_count(size_t bytes)
+	{
+		size_t threads = std::max(1u, std::thread::hardware_concurrency());
+		return std::clamp<size_t>(bytes / MIN_CHUNK_BYTES, 1, 4 * threads);
+	}
+
+	template <typename T>
+	size_t bytes_of(const std::vector<T>& buffer)
+	{
+		return buffer.capacity() * sizeof(T);
+	}
+
+	// splits [begin, end) into at most count ranges that each start at the beginning of a line
+	std::vector<const char*> split_lines(const char* begin, const char* end, size_t count)
+	{
+		std::vector<const char*> bounds{ begin };
+		for (size_t i = 1; i < count; i++)
+		{
+			const char* p = begin + (end - begin) * i / count;
+			const char* newline = (const char*)std::memchr(p, '\n', end - p);
+			p = newline ? newline + 1 : end;
+
+			if (p > bounds.back() && p < end)
+				bounds.push_back(p);
+		}
+
+		bounds.push_back(end);
+		return bounds;
+	}
+
+	const char* line_end(const char* p, const char* end)
+	{
+		const char* newline = (const char*)std::memchr(p, '\n', end - p);
+		return newline ? newline : end;
+	}
+
+	const char* skip_space(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+		return p;
+	}
+
+	// from_chars is locale independent and needs no terminator, but doesn't take a leading '+'
+	template <typename T>
+	bool parse_number(const char*& p, const char* end, T& value)
+	{
+		p = skip_space(p, end);
+		if (p < end && *p == '+')
+			p++;
+
+		auto [next, result] = std::from_chars(p, end, value);
+		if (result != std::errc())
+			return false;
+
+		p = next;
+		return true;
+	}
+
+	bool is_keyword(const char* p, const char* end, const char* keyword)
+	{
+		size_t length = std::strlen(keyword);
+		return (size_t)(end - p) > length && std::memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+	}
+
+	// OBJ
+
+	struct obj_chunk
+	{
+		const char* begin;
+		const char* end;
+
+		size_t vertices{ 0 };
+		size_t normals{ 0 };
+		size_t triangles{ 0 };
+		bool corner_normals{ true }; // every face corner names a normal
+
+		size_t first_vertex{ 0 };
+		size_t first_normal{ 0 };
+		size_t first_triangle{ 0 };
+
+		const char* error{};
+	};
+
+	void count_obj(obj_chunk& chunk)
+	{
+		for (const char* line = chunk.begin; line < chunk.end;)
+		{
+			const char* end = line_end(line, chunk.end);
+			const char* p = skip_space(line, end);
+
+			if (is_keyword(p, end, "v"))
+			{
+				chunk.vertices++;
+			}
+			else if (is_keyword(p, end, "vn"))
+			{
+				chunk.normals++;
+			}
+			else if (is_keyword(p, end, "f"))
+			{
+				size_t corners = 0;
+				for (p = skip_space(p + 1, end); p < end; p = skip_space(p, end))
+				{
+					int slashes = 0;
+					bool normal = false;
+					for (; p < end && *p != ' ' && *p != '\t' && *p != '\r'; p++)
+					{
+						if (*p == '/')
+							slashes++;
+						else if (slashes == 2)
+							normal = true;
+					}
+
+					chunk.corner_normals = chunk.corner_normals && normal;
+					corners++;
+				}
+
+				chunk.triangles += corners >= 3 ? corners - 2 : 0;
+			}
+
+			line = end + 1;
+		}
+	}
+
+	// OBJ indices are 1-based, negative ones count back from the last element defined before them
+	bool resolve_obj_index(int64_t index, size_t defined, size_t total, uint32_t& resolved)
+	{
+		int64_t absolute = index > 0 ? index - 1 : (int64_t)defined + index;
+		if (index == 0 || absolute < 0 || absolute >= (int64_t)total)
+			return false;
+
+		resolved = (uint32_t)absolute;
+		return true;
+	}
+
+	void parse_obj(obj_chunk& chunk, triangle_mesh& mesh, std::vector<glm::vec3>& file_normals, std::vector<uint32_t>& corner_normals)
+	{
+		size_t vertex = chunk.first_vertex;
+		size_t normal = chunk.first_normal;
+		size_t corner = 3 * chunk.first_triangle;
+
+		for (const char* line = chunk.begin; line < chunk.end; line = line_end(line, chunk.end) + 1)
+		{
+			const char* end = line_end(line, chunk.end);
+			const char* p = skip_space(line, end);
+
+			if (is_keyword(p, end, "v") || is_keyword(p, end, "vn"))
+			{
+				bool is_normal = p[1] == 'n';
+				glm::vec3 value;
+				p += is_normal ? 2 : 1;
+
+				if (!parse_number(p, end, value.x) || !parse_number(p, end, value.y) || !parse_number(p, end, value.z))
+				{
+					chunk.error = line;
+					return;
+				}
+
+				if (is_normal)
+					file_normals[normal++] = value;
+				else
+					mesh.positions[vertex++] = value;
+			}
+			else if (is_keyword(p, end, "f"))
+			{
+				uint32_t first[2]{}, previous[2]{};
+				size_t corners = 0;
+
+				for (p = skip_space(p + 1, end); p < end; p = skip_space(p, end), corners++)
+				{
+					int64_t index;
+					uint32_t resolved[2]{};
+
+					if (!parse_number(p, end, index) || !resolve_obj_index(index, vertex, mesh.positions.size(), resolved[0]))
+					{
+						chunk.error = line;
+						return;
+					}
+
+					// v/vt/vn, the texture coordinate is skipped
+					if (p < end && *p == '/')
+					{
+						p++;
+						if (p < end && *p != '/' && !parse_number(p, end, index))
+						{
+							chunk.error = line;
+							return;
+						}
+
+						if (p < end && *p == '/')
+						{
+							p++;
+							if (!parse_number(p, end, index) || !resolve_obj_index(index, normal, file_normals.size(), resolved[1]))
+							{
+								chunk.error = line;
+								return;
+							}
+						}
+					}
+
+					// corners were counted as whitespace separated words, anything else would overrun the chunk's triangles
+					if (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+					{
+						chunk.error = line;
+						return;
+					}
+
+					if (corners == 0)
+					{
+						first[0] = resolved[0];
+						first[1] = resolved[1];
+					}
+					else if (corners >= 2)
+					{
+						uint32_t triangle[3][2]{ { first[0], first[1] }, { previous[0], previous[1] }, { resolved[0], resolved[1] } };
+						for (int k = 0; k < 3; k++, corner++)
+						{
+							mesh.indices[corner] = triangle[k][0];
+							if (!corner_normals.empty())
+								corner_normals[corner] = triangle[k][1];
+						}
+					}
+
+					previous[0] = resolved[0];
+					previous[1] = resolved[1];
+				}
+			}
+		}
+	}
+
+	// PLY
+
+	enum class ply_type
+	{
+		int8, uint8, int16, uint16, int32, uint32, float32, float64, invalid
+	};
+
+	struct ply_property
+	{
+		std::string name;
+		ply_type type{ ply_type::invalid };
+		ply_type count_type{ ply_type::invalid }; // lists only
+		bool list{ false };
+	};
+
+	struct ply_element
+	{
+		std::string name;
+		size_t count{ 0 };
+		std::vector<ply_property> properties;
+
+		int find(const std::string& property) const
+		{
+			for (size_t i = 0; i < properties.size(); i++)
+			{
+				if (properties[i].name == property)
+					return (int)i;
+			}
+			return -1;
+		}
+	};
+
+	struct ply_chunk
+	{
+		const char* begin;
+		const char* end;
+		size_t first_record{ 0 };
+		size_t records{ 0 };
+
+		size_t first_triangle{ 0 };
+		size_t triangles{ 0 };
+
+		bool failed{ false };
+	};
+
+	ply_type parse_ply_type(const std::string& name)
+	{
+		if (name == "char" || name == "int8") return ply_type::int8;
+		if (name == "uchar" || name == "uint8") return ply_type::uint8;
+		if (name == "short" || name == "int16") return ply_type::int16;
+		if (name == "ushort" || name == "uint16") return ply_type::uint16;
+		if (name == "int" || name == "int32") return ply_type::int32;
+		if (name == "uint" || name == "uint32") return ply_type::uint32;
+		if (name == "float" || name == "float32") return ply_type::float32;
+		if (name == "double" || name == "float64") return ply_type::float64;
+		return ply_type::invalid;
+	}
+
+	size_t type_size(ply_type type)
+	{
+		switch (type)
+		{
+		case ply_type::int8: case ply_type::uint8: return 1;
+		case ply_type::int16: case ply_type::uint16: return 2;
+		case ply_type::int32: case ply_type::uint32: case ply_type::float32: return 4;
+		case ply_type::float64: return 8;
+		default: return 0;
+		}
+	}
+
+	// the fewest bytes a record of this element can take: its scalars and list counts in binary files,
+	// at least one character in ascii ones. Counted as one byte when it has no properties
+	size_t min_record_size(const ply_element& element, bool ascii)
+	{
+		if (ascii)
+			return 1;
+
+		size_t size = 0;
+		for (const ply_property& property : element.properties)
+			size += type_size(property.list ? property.count_type : property.type);
+		return std::max<size_t>(size, 1);
+	}
+
+	// header counts are checked against what is left of the file before anything is sized from them
+	bool counts_fit(const std::vector<ply_element>& elements, bool ascii, size_t remaining)
+	{
+		for (const ply_element& element : elements)
+		{
+			size_t size = min_record_size(element, ascii);
+			if (element.count > remaining / size)
+				return false;
+			remaining -= element.count * size;
+		}
+		return true;
+	}
+
+	template <typename T>
+	T load_value(const uint8_t* p, bool swap)
+	{
+		uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, p, sizeof(T));
+		if (swap)
+			std::reverse(bytes, bytes + sizeof(T));
+
+		T value;
+		std::memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	double read_scalar(const uint8_t* p, ply_type type, bool swap)
+	{
+		switch (type)
+		{
+		case ply_type::int8: return load_value<int8_t>(p, swap);
+		case ply_type::uint8: return load_value<uint8_t>(p, swap);
+		case ply_type::int16: return load_value<int16_t>(p, swap);
+		case ply_type::uint16: return load_value<uint16_t>(p, swap);
+		case ply_type::int32: return load_value<int32_t>(p, swap);
+		case ply_type::uint32: return load_value<uint32_t>(p, swap);
+		case ply_type::float32: return load_value<float>(p, swap);
+		default: return load_value<double>(p, swap);
+		}
+	}
+
+	// Walks one record, handing every entry of property `list` to corner. Binary records are bounds
+	// checked against end, ascii records are one line. Returns false if the record is malformed
+	template <typename Corner>
+	bool read_binary_record(const uint8_t*& p, const uint8_t* end, const ply_element& element, bool swap, int list, Corner corner)
+	{
+		for (int i = 0; i < (int)element.properties.size(); i++)
+		{
+			const ply_property& property = element.properties[i];
+			if (!property.list)
+			{
+				if ((size_t)(end - p) < type_size(property.type))
+					return false;
+				p += type_size(property.type);
+				continue;
+			}
+
+			if ((size_t)(end - p) < type_size(property.count_type))
+				return false;
+
+			double count = read_scalar(p, property.count_type, swap);
+			p += type_size(property.count_type);
+
+			size_t size = type_size(property.type);
+			if (count < 0.0 || (double)(end - p) < count * size)
+				return false;
+
+			for (size_t k = 0; k < (size_t)count; k++, p += size)
+			{
+				if (i == list)
+					corner(read_scalar(p, property.type, swap));
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Corner>
+	bool read_ascii_record(const char* p, const char* end, const ply_element& element, int list, Corner corner)
+	{
+		for (int i = 0; i < (int)element.properties.size(); i++)
+		{
+			double value;
+			if (!parse_number(p, end, value))
+				return false;
+
+			if (!element.properties[i].list)
+				continue;
+
+			if (value < 0.0)
+				return false;
+
+			for (size_t k = 0, count = (size_t)value; k < count; k++)
+			{
+				if (!parse_number(p, end, value))
+					return false;
+				if (i == list)
+					corner(value);
+			}
+		}
+
+		return true;
+	}
+
+	// fans the corners of each face into triangles written from `corner`, flags indices outside the vertex buffer
+	struct face_writer
+	{
+		std::vector<uint32_t>& indices;
+		size_t vertex_count;
+		size_t corner;
+
+		size_t corners{ 0 };
+		uint32_t first{ 0 };
+		uint32_t previous{ 0 };
+		bool failed{ false };
+
+		void begin_face() { corners = 0; }
+
+		void operator()(double value)
+		{
+			if (value < 0.0 || value >= (double)vertex_count)
+			{
+				failed = true;
+				return;
+			}
+
+			uint32_t index = (uint32_t)value;
+			if (corners == 0)
+			{
+				first = index;
+			}
+			else if (corners >= 2)
+			{
+				indices[corner++] = first;
+				indices[corner++] = previous;
+				indices[corner++] = index;
+			}
+
+			previous = index;
+			corners++;
+		}
+	};
+
+	size_t fan_triangles(size_t corners)
+	{
+		return corners >= 3 ? corners - 2 : 0;
+	}
+
+	bool parse_ply_header(const char*& p, const char* end, bool& ascii, bool& swap, std::vector<ply_element>& elements, std::string& error)
+	{
+		if (end - p < 4 || std::memcmp(p, "ply", 3) != 0 || (p[3] != '\n' && p[3] != '\r'))
+		{
+			error = "not a PLY file";
+			return false;
+		}
+
+		bool has_format = false;
+		for (const char* line = p; line < end; line = line_end(line, end) + 1)
+		{
+			const char* next = line_end(line, end);
+			std::string text(line, next);
+			if (!text.empty() && text.back() == '\r')
+				text.pop_back();
+
+			std::vector<std::string> words;
+			for (size_t i = 0; i < text.size();)
+			{
+				size_t start = text.find_first_not_of(" \t", i);
+				if (start == std::string::npos)
+					break;
+				i = std::min(text.find_first_of(" \t", start), text.size());
+				words.push_back(text.substr(start, i - start));
+			}
+
+			if (words.empty() || words[0] == "ply" || words[0] == "comment" || words[0] == "obj_info")
+				continue;
+
+			if (words[0] == "end_header")
+			{
+				p = std::min(next + 1, end);
+				if (!has_format)
+					error = "PLY header has no format";
+				return has_format;
+			}
+
+			if (words[0] == "format" && words.size() >= 2)
+			{
+				has_format = true;
+				ascii = words[1] == "ascii";
+				swap = words[1] == "binary_big_endian";
+				if (!ascii && !swap && words[1] != "binary_little_endian")
+				{
+					error = "unknown PLY format " + words[1];
+					return false;
+				}
+			}
+			else if (words[0] == "element" && words.size() >= 3)
+			{
+				ply_element element;
+				element.name = words[1];
+				auto [last, result] = std::from_chars(words[2].data(), words[2].data() + words[2].size(), element.count);
+				if (result != std::errc())
+				{
+					error = "bad PLY element count " + words[2];
+					return false;
+				}
+				elements.push_back(element);
+			}
+			else if (words[0] == "property" && !elements.empty())
+			{
+				ply_property property;
+				if (words.size() >= 5 && words[1] == "list")
+				{
+					property.list = true;
+					property.count_type = parse_ply_type(words[2]);
+					property.type = parse_ply_type(words[3]);
+					property.name = words[4];
+				}
+				else if (words.size() >= 3)
+				{
+					property.type = parse_ply_type(words[1]);
+					property.name = words[2];
+				}
+
+				if (property.type == ply_type::invalid || (property.list && property.count_type == ply_type::invalid))
+				{
+					error = "unsupported PLY property: " + text;
+					return false;
+				}
+				elements.back().properties.push_back(property);
+			}
+			else
+			{
+				error = "unexpected PLY header line: " + text;
+				return false;
+			}
+		}
+
+		error = "PLY header has no end_header";
+		return false;
+	}
+
+	// splits an ascii element into line-aligned chunks of whole records, p ends up after its last record
+	bool split_ascii_records(const char*& p, const char* end, size_t count, std::vector<ply_chunk>& chunks)
+	{
+		size_t per_chunk = std::max<size_t>(1, count / chunk_count(end - p));
+		for (size_t record = 0; record < count; record++)
+		{
+			if (p >= end)
+				return false;
+
+			if (record % per_chunk == 0)
+				chunks.push_back({ p, p, record, 0 });
+
+			p = line_end(p, end) + 1;
+			chunks.back().end = std::min(p, end);
+			chunks.back().records++;
+		}
+
+		return true;
+	}
+}
+
+bool mesh_io::load_obj(const std::string& path, triangle_mesh& mesh, load_stats& stats, std::string& error)
+{
+	auto start = clock::now();
+	stats = {};
+
+	mapped_file file;
+	if (!file.open(path))
+	{
+		error = "can't open " + path;
+		return false;
+	}
+
+	const char* data = (const char*)file.data();
+	std::vector<const char*> bounds = split_lines(data, data + file.size(), chunk_count(file.size()));
+
+	std::vector<obj_chunk> chunks(bounds.size() - 1);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		chunks[i].begin = bounds[i];
+		chunks[i].end = bounds[i + 1];
+	}
+
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(), count_obj);
+
+	// each chunk writes from where the ones before it end
+	size_t vertices = 0, normals = 0, triangles = 0;
+	bool corner_normals = true;
+	for (obj_chunk& chunk : chunks)
+	{
+		chunk.first_vertex = vertices;
+		chunk.first_normal = normals;
+		chunk.first_triangle = triangles;
+		vertices += chunk.vertices;
+		normals += chunk.normals;
+		triangles += chunk.triangles;
+		corner_normals = corner_normals && chunk.corner_normals;
+	}
+
+	triangle_mesh loaded;
+	loaded.positions.resize(vertices);
+	loaded.indices.resize(3 * triangles);
+
+	std::vector<glm::vec3> file_normals(normals);
+	std::vector<uint32_t> normal_indices(corner_normals && normals > 0 ? 3 * triangles : 0);
+
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](obj_chunk& chunk)
+	{
+		parse_obj(chunk, loaded, file_normals, normal_indices);
+	});
+
+	for (const obj_chunk& chunk : chunks)
+	{
+		if (chunk.error)
+		{
+			const char* line_start = chunk.error;
+			error = path + ": can't parse \"" + std::string(line_start, std::min(line_end(line_start, data + file.size()), line_start + 80)) + "\"";
+			return false;
+		}
+	}
+
+	if (triangles == 0)
+	{
+		error = path + ": no faces";
+		return false;
+	}
+
+	// a vertex keeps the first normal it is used with, corners that give it another one get a copy of it
+	// with theirs, so hard edges stay hard
+	std::vector<uint32_t> vertex_normals;
+	std::unordered_map<uint64_t, uint32_t> split_vertices; // (vertex, normal) pairs to their copy
+	if (!normal_indices.empty())
+	{
+		vertex_normals.assign(vertices, UINT32_MAX);
+		for (size_t i = 0; i < normal_indices.size(); i++)
+		{
+			uint32_t vertex = loaded.indices[i];
+			uint32_t normal = normal_indices[i];
+			uint32_t assigned = vertex_normals[vertex];
+
+			if (assigned == UINT32_MAX)
+			{
+				vertex_normals[vertex] = normal;
+				continue;
+			}
+
+			if (assigned == normal || file_normals[assigned] == file_normals[normal])
+				continue;
+
+			auto [split, inserted] = split_vertices.try_emplace((uint64_t)vertex << 32 | normal, (uint32_t)loaded.positions.size());
+			if (inserted)
+			{
+				glm::vec3 position = loaded.positions[vertex];
+				loaded.positions.push_back(position);
+				vertex_normals.push_back(normal);
+			}
+			loaded.indices[i] = split->second;
+		}
+	}
+
+	if (!vertex_normals.empty())
+	{
+		loaded.normals.resize(loaded.positions.size());
+		std::transform(std::execution::par, vertex_normals.begin(), vertex_normals.end(), loaded.normals.begin(), [&](uint32_t normal)
+		{
+			return normal == UINT32_MAX ? glm::vec3(0.0f) : glm::normalize(file_normals[normal]);
+		});
+	}
+	else
+	{
+		loaded.compute_normals();
+	}
+
+	stats.peak_bytes = bytes_of(loaded.positions) + bytes_of(loaded.normals) + bytes_of(loaded.indices)
+		+ bytes_of(file_normals) + bytes_of(normal_indices) + bytes_of(vertex_normals) + bytes_of(chunks) + bytes_of(bounds)
+		+ split_vertices.size() * sizeof(decltype(split_vertices)::value_type);
+
+	loaded.material_index = mesh.material_index;
+	mesh = std::move(loaded);
+
+	stats.file_bytes = file.size();
+	stats.vertices = mesh.positions.size();
+	stats.triangles = triangles;
+	stats.chunks = chunks.size();
+	stats.load_ms = std::chrono::duration<float, std::milli>(clock::now() - start).count();
+	return true;
+}
+
+bool mesh_io::load_ply(const std::string& path, triangle_mesh& mesh, load_stats& stats, std::string& error)
+{
+	auto start = clock::now();
+	stats = {};
+
+	mapped_file file;
+	if (!file.open(path))
+	{
+		error = "can't open " + path;
+		return false;
+	}
+
+	const char* p = (const char*)file.data();
+	const char* end = p + file.size();
+
+	bool ascii = true;
+	bool swap = false;
+	std::vector<ply_element> elements;
+	if (!parse_ply_header(p, end, ascii, swap, elements, error))
+	{
+		error = path + ": " + error;
+		return false;
+	}
+
+	if (!counts_fit(elements, ascii, end - p))
+	{
+		error = path + ": element counts don't fit in the file";
+		return false;
+	}
+
+	auto vertex_element = std::find_if(elements.begin(), elements.end(), [](const ply_element& e) { return e.name == "vertex"; });
+	if (vertex_element == elements.end())
+	{
+		error = path + ": no vertex element";
+		return false;
+	}
+
+	int coordinates[3]{ vertex_element->find("x"), vertex_element->find("y"), vertex_element->find("z") };
+	int normal_components[3]{ vertex_element->find("nx"), vertex_element->find("ny"), vertex_element->find("nz") };
+	bool has_normals = normal_components[0] >= 0 && normal_components[1] >= 0 && normal_components[2] >= 0;
+
+	if (coordinates[0] < 0 || coordinates[1] < 0 || coordinates[2] < 0)
+	{
+		error = path + ": vertices have no x, y and z";
+		return false;
+	}
+
+	triangle_mesh loaded;
+	loaded.positions.resize(vertex_element->count);
+	if (has_normals)
+		loaded.normals.resize(vertex_element->count);
+
+	std::vector<ply_chunk> chunks;
+	size_t chunk_total = 0;
+	size_t triangles = 0;
+
+	for (const ply_element& element : elements)
+	{
+		bool is_vertex = &element == &*vertex_element;
+		bool is_face = element.name == "face";
+		int list = is_face ? std::max(element.find("vertex_indices"), element.find("vertex_index")) : -1;
+
+		if (is_face && (list < 0 || !element.properties[list].list))
+		{
+			error = path + ": faces have no vertex_indices list";
+			return false;
+		}
+
+		chunks.clear();
+		bool split = true;
+
+		if (ascii)
+		{
+			split = split_ascii_records(p, end, element.count, chunks);
+		}
+		else if (is_vertex)
+		{
+			// fixed size records, decoded straight from their offsets
+			size_t record_size = 0;
+			for (const ply_property& property : element.properties)
+			{
+				if (property.list)
+				{
+					error = path + ": list properties on vertices aren't supported in binary files";
+					return false;
+				}
+				record_size += type_size(property.type);
+			}
+
+			split = record_size > 0 && (size_t)(end - p) / record_size >= element.count;
+			if (split)
+			{
+				size_t per_chunk = std::max<size_t>(1, element.count / chunk_count(element.count * record_size));
+				for (size_t record = 0; record < element.count; record += per_chunk)
+				{
+					size_t records = std::min(per_chunk, element.count - record);
+					chunks.push_back({ p + record * record_size, p + (record + records) * record_size, record, records });
+				}
+				p += element.count * record_size;
+			}
+		}
+		else
+		{
+			// variable size records are walked once to find where each chunk starts and how many triangles it holds
+			size_t per_chunk = std::max<size_t>(1, element.count / chunk_count(end - p));
+			const uint8_t* record = (const uint8_t*)p;
+			size_t corners = 0;
+
+			for (size_t i = 0; i < element.count && split; i++)
+			{
+				if (i % per_chunk == 0)
+					chunks.push_back({ (const char*)record, (const char*)record, i, 0 });
+
+				corners = 0;
+				split = read_binary_record(record, (const uint8_t*)end, element, swap, list, [&](double) { corners++; });
+				chunks.back().end = (const char*)record;
+				chunks.back().records++;
+				chunks.back().triangles += fan_triangles(corners);
+			}
+			p = (const char*)record;
+		}
+
+		if (!split)
+		{
+			error = path + ": file ends inside the " + element.name + " element";
+			return false;
+		}
+
+		chunk_total += chunks.size();
+
+		if (is_vertex)
+		{
+			std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](ply_chunk& chunk)
+			{
+				std::vector<double> values(element.properties.size());
+				const char* record = chunk.begin;
+
+				for (size_t i = 0; i < chunk.records; i++)
+				{
+					if (ascii)
+					{
+						const char* line = record;
+						record = line_end(record, chunk.end) + 1;
+						for (double& value : values)
+						{
+							if (!parse_number(line, chunk.end, value))
+							{
+								chunk.failed = true;
+								return;
+							}
+						}
+					}
+					else
+					{
+						for (size_t k = 0; k < values.size(); k++)
+						{
+							values[k] = read_scalar((const uint8_t*)record, element.properties[k].type, swap);
+							record += type_size(element.properties[k].type);
+						}
+					}
+
+					size_t vertex = chunk.first_record + i;
+					loaded.positions[vertex] = { values[coordinates[0]], values[coordinates[1]], values[coordinates[2]] };
+					if (has_normals)
+						loaded.normals[vertex] = { values[normal_components[0]], values[normal_components[1]], values[normal_components[2]] };
+				}
+			});
+		}
+		else if (is_face)
+		{
+			// ascii chunks are counted in parallel, binary ones were counted while splitting
+			if (ascii)
+			{
+				std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](ply_chunk& chunk)
+				{
+					for (const char* line = chunk.begin; line < chunk.end && !chunk.failed; line = line_end(line, chunk.end) + 1)
+					{
+						size_t corners = 0;
+						chunk.failed = !read_ascii_record(line, line_end(line, chunk.end), element, list, [&](double) { corners++; });
+						chunk.triangles += fan_triangles(corners);
+					}
+				});
+			}
+
+			for (ply_chunk& chunk : chunks)
+			{
+				chunk.first_triangle = triangles;
+				triangles += chunk.triangles;
+			}
+			loaded.indices.resize(3 * triangles);
+
+			std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](ply_chunk& chunk)
+			{
+				face_writer writer{ loaded.indices, loaded.positions.size(), 3 * chunk.first_triangle };
+				const char* record = chunk.begin;
+
+				for (size_t i = 0; i < chunk.records && !chunk.failed; i++)
+				{
+					writer.begin_face();
+					if (ascii)
+					{
+						const char* line = record;
+						record = line_end(record, chunk.end) + 1;
+						chunk.failed = !read_ascii_record(line, line_end(line, chunk.end), element, list, std::ref(writer));
+					}
+					else
+					{
+						const uint8_t* binary = (const uint8_t*)record;
+						chunk.failed = !read_binary_record(binary, (const uint8_t*)chunk.end, element, swap, list, std::ref(writer));
+						record = (const char*)binary;
+					}
+				}
+
+				chunk.failed = chunk.failed || writer.failed || writer.corner != 3 * (chunk.first_triangle + chunk.triangles);
+			});
+		}
+
+		if (std::any_of(chunks.begin(), chunks.end(), [](const ply_chunk& chunk) { return chunk.failed; }))
+		{
+			error = path + ": malformed " + element.name + " element";
+			return false;
+		}
+	}
+
+	if (triangles == 0)
+	{
+		error = path + ": no faces";
+		return false;
+	}
+
+	if (has_normals)
+	{
+		std::for_each(std::execution::par, loaded.normals.begin(), loaded.normals.end(), [](glm::vec3& normal)
+		{
+			float length = glm::length(normal);
+			normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+		});
+	}
+	else
+	{
+		loaded.compute_normals();
+	}
+
+	stats.peak_bytes = bytes_of(loaded.positions) + bytes_of(loaded.normals) + bytes_of(loaded.indices) + bytes_of(chunks);
+
+	loaded.material_index = mesh.material_index;
+	mesh = std::move(loaded);
+
+	stats.file_bytes = file.size();
+	stats.vertices = mesh.positions.size();
+	stats.triangles = triangles;
+	stats.chunks = chunk_total;
+	stats.load_ms = std::chrono::duration<float, std::milli>(clock::now() - start).count();
+	return true;
+}
+
+bool mesh_io::load(const std::string& path, triangle_mesh& mesh, load_stats& stats, std::string& error)
+{
+	std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (extension == ".obj")
+		return load_obj(path, mesh, stats, error);
+	if (extension == ".ply")
+		return load_ply(path, mesh, stats, error);
+
+	error = path + ": unknown mesh format, expected .obj or .ply";
+	return false;
+}
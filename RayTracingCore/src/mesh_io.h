@@ -0,0 +1,36 @@
+#pragma once
+#include "triangle_mesh.h"
+#include <string>
+
+// Reads triangle meshes from OBJ and PLY files. The file is memory mapped and split into chunks that
+// are parsed in parallel: a first pass counts what each chunk holds so the mesh's buffers are sized
+// once, and a second pass writes every chunk's vertices and triangles straight into its own range of
+// them. Polygons are fanned into triangles, texture coordinates and materials are ignored.
+namespace mesh_io
+{
+	struct load_stats
+	{
+		size_t file_bytes{ 0 };
+		size_t vertices{ 0 };
+		size_t triangles{ 0 };
+		size_t chunks{ 0 };
+
+		// the most memory the loader's own buffers held at once, the finished mesh included and the mapped file not
+		size_t peak_bytes{ 0 };
+		float load_ms{ 0.0f };
+
+		float ms_per_million_triangles() const { return triangles ? load_ms * 1e6f / triangles : 0.0f; }
+		float bytes_per_million_triangles() const { return triangles ? (float)peak_bytes * 1e6f / triangles : 0.0f; }
+	};
+
+	// v, vn and f lines, with negative indices and v/vt/vn corners. File normals are used if every face
+	// has them, a vertex used with several is split into one per normal, otherwise smooth normals are computed
+	bool load_obj(const std::string& path, triangle_mesh& mesh, load_stats& stats, std::string& error);
+
+	// ascii and binary of either byte order, x y z and optional nx ny nz per vertex and a
+	// vertex_indices list per face. Normals are computed if the file has none
+	bool load_ply(const std::string& path, triangle_mesh& mesh, load_stats& stats, std::string& error);
+
+	// picks the format from the extension, .obj or .ply
+	bool load(const std::string& path, triangle_mesh& mesh, load_stats& stats, std::string& error);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "ray.h"
 #include "extent.h"
+#include <memory>
 
 class object
 {
@@ -9,11 +10,15 @@ public:
 
 	int material_index{ 0 };
 
+	virtual ~object() = default;
+
 	virtual float hit(const ray &ray) const = 0;
 
 	virtual extent get_extent(const std::vector<int>& normal_indices) const = 0;
 
 	virtual glm::vec3 getNormalAt(const glm::vec3& worldPosition) const = 0;
+
+	virtual std::unique_ptr<object> clone() const = 0;
 };
 
 class sphere : public object
@@ -26,5 +31,7 @@ public:
 	extent get_extent(const std::vector<int>& normal_indices) const override;
 
 	virtual glm::vec3 getNormalAt(const glm::vec3& worldPosition) const override;
-	
+
+	std::unique_ptr<object> clone() const override { return std::make_unique<sphere>(*this); }
+
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include "ray.h"
+#include "sampler.h"
+#include <vector>
+
+// Paths in flight for the wavefront integrator. Rays are stored as structure of arrays so a whole queue
+// is traced before any of it is shaded, the rest of the path state travels alongside them.
+struct path_queue
+{
+	std::vector<float> origin_x;
+	std::vector<float> origin_y;
+	std::vector<float> origin_z;
+	std::vector<float> direction_x;
+	std::vector<float> direction_y;
+	std::vector<float> direction_z;
+
+	std::vector<glm::vec3> throughput;
+	std::vector<float> pdf; // of the direction the ray was sampled in, 0 for camera rays
+	std::vector<uint32_t> slot; // pixel of the tile the path contributes to
+	std::vector<sampler> rng;
+
+	size_t size() const { return slot.size(); }
+
+	void clear()
+	{
+		origin_x.clear();
+		origin_y.clear();
+		origin_z.clear();
+		direction_x.clear();
+		direction_y.clear();
+		direction_z.clear();
+		throughput.clear();
+		pdf.clear();
+		slot.clear();
+		rng.clear();
+	}
+
+	void push(const ray& ray, const glm::vec3& pathThroughput, float pathPdf, uint32_t pathSlot, const sampler& pathRng)
+	{
+		origin_x.push_back(ray.origin.x);
+		origin_y.push_back(ray.origin.y);
+		origin_z.push_back(ray.origin.z);
+		direction_x.push_back(ray.direction.x);
+		direction_y.push_back(ray.direction.y);
+		direction_z.push_back(ray.direction.z);
+		throughput.push_back(pathThroughput);
+		pdf.push_back(pathPdf);
+		slot.push_back(pathSlot);
+		rng.push_back(pathRng);
+	}
+
+	ray get_ray(size_t i) const
+	{
+		return { { origin_x[i], origin_y[i], origin_z[i] }, { direction_x[i], direction_y[i], direction_z[i] } };
+	}
+};
@@ -0,0 +1,68 @@
+#include "primitive_list.h"
+#include "instance.h"
+#include <algorithm>
+
+primitive_list::primitive_list(const std::vector<std::unique_ptr<object>>& objects, const std::vector<std::unique_ptr<triangle_mesh>>& meshes,
+	const std::vector<std::unique_ptr<instance>>& instances)
+	: m_objects(&objects), m_meshes(&meshes), m_instances(&instances)
+{
+	m_offsets.reserve(meshes.size() + 1);
+	m_offsets.push_back(objects.size());
+
+	for (const std::unique_ptr<triangle_mesh>& mesh : meshes)
+	{
+		m_offsets.push_back(m_offsets.back() + mesh->triangle_count());
+	}
+}
+
+const std::vector<std::unique_ptr<instance>>& primitive_list::no_instances()
+{
+	static const std::vector<std::unique_ptr<instance>> empty;
+	return empty;
+}
+
+const instance& primitive_list::get_instance(uint32_t primitive) const
+{
+	return *(*m_instances)[primitive - first_instance()];
+}
+
+const triangle_mesh& primitive_list::get_mesh(uint32_t primitive, uint32_t& triangle) const
+{
+	// scenes hold a handful of meshes, the search is over those and not over triangles
+	size_t mesh = std::upper_bound(m_offsets.begin(), m_offsets.end(), (size_t)primitive) - m_offsets.begin() - 1;
+	triangle = (uint32_t)(primitive - m_offsets[mesh]);
+	return *(*m_meshes)[mesh];
+}
+
+extent primitive_list::get_extent(uint32_t primitive, const std::vector<int>& normal_indices) const
+{
+	if (is_instance(primitive))
+		return get_instance(primitive).get_extent(normal_indices);
+	if (!is_triangle(primitive))
+		return get_object(primitive).get_extent(normal_indices);
+
+	uint32_t triangle;
+	return get_mesh(primitive, triangle).get_extent(triangle, normal_indices);
+}
+
+glm::vec3 primitive_list::get_centre(uint32_t primitive) const
+{
+	if (is_instance(primitive))
+		return get_instance(primitive).get_centre();
+	if (!is_triangle(primitive))
+		return get_object(primitive).position;
+
+	uint32_t triangle;
+	return get_mesh(primitive, triangle).get_centroid(triangle);
+}
+
+int primitive_list::get_material(uint32_t primitive) const
+{
+	if (is_instance(primitive))
+		return get_instance(primitive).material_index;
+	if (!is_triangle(primitive))
+		return get_object(primitive).material_index;
+
+	uint32_t triangle;
+	return get_mesh(primitive, triangle).material_index;
+}
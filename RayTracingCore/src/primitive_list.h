@@ -0,0 +1,52 @@
+#pragma once
+#include "object.h"
+#include "triangle_mesh.h"
+#include <memory>
+#include <vector>
+
+class instance;
+
+// Everything the BVH is built over, addressed by one index: the scene's objects come first, in
+// order, followed by the triangles of each mesh and then the instances. Triangles are resolved
+// through their mesh's index buffer on demand. The list only refers to the scene's containers,
+// which must outlive it.
+class primitive_list
+{
+public:
+	primitive_list() = default;
+	primitive_list(const std::vector<std::unique_ptr<object>>& objects, const std::vector<std::unique_ptr<triangle_mesh>>& meshes,
+		const std::vector<std::unique_ptr<instance>>& instances = no_instances());
+
+	size_t size() const { return m_offsets.empty() ? 0 : m_offsets.back() + instance_count(); }
+	size_t object_count() const { return m_objects ? m_objects->size() : 0; }
+	size_t instance_count() const { return m_instances ? m_instances->size() : 0; }
+
+	// primitive index of the first instance, the rest follow in order
+	size_t first_instance() const { return m_offsets.empty() ? 0 : m_offsets.back(); }
+
+	bool is_triangle(uint32_t primitive) const { return primitive >= object_count() && primitive < first_instance(); }
+	bool is_instance(uint32_t primitive) const { return primitive >= first_instance(); }
+
+	const object& get_object(uint32_t primitive) const { return *(*m_objects)[primitive]; }
+	const instance& get_instance(uint32_t primitive) const;
+
+	// the mesh a triangle primitive belongs to and its triangle index within that mesh
+	const triangle_mesh& get_mesh(uint32_t primitive, uint32_t& triangle) const;
+
+	extent get_extent(uint32_t primitive, const std::vector<int>& normal_indices) const;
+
+	// the point the octree sorts primitives by
+	glm::vec3 get_centre(uint32_t primitive) const;
+
+	int get_material(uint32_t primitive) const;
+
+private:
+	const std::vector<std::unique_ptr<object>>* m_objects{};
+	const std::vector<std::unique_ptr<triangle_mesh>>* m_meshes{};
+	const std::vector<std::unique_ptr<instance>>* m_instances{};
+
+	// first primitive of each mesh, with the objects before them and the first instance at the end
+	std::vector<size_t> m_offsets;
+
+	static const std::vector<std::unique_ptr<instance>>& no_instances();
+};
@@ -0,0 +1,224 @@
+#include "ray_packet.h"
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+#if RT_SIMD_X86
+	inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// lane bits of group g (four rays) in a 16 bit packet mask
+	inline __m128 lane_mask(uint32_t mask, int g)
+	{
+		uint32_t bits = mask >> (4 * g);
+		return _mm_castsi128_ps(_mm_set_epi32(
+			(bits & 8) ? -1 : 0, (bits & 4) ? -1 : 0, (bits & 2) ? -1 : 0, (bits & 1) ? -1 : 0));
+	}
+#endif
+}
+
+void ray_packet::load(const ray* rays, int count)
+{
+	bool same_origin = true;
+	origin = rays[0].origin;
+	inverse_min = glm::vec3(FLT_MAX);
+	inverse_max = glm::vec3(-FLT_MAX);
+
+	bool positive[3]{};
+	bool negative[3]{};
+
+	for (int i = 0; i < SIZE; i++)
+	{
+		// unused lanes repeat the first ray so every lane holds finite numbers
+		const ray& r = rays[i < count ? i : 0];
+
+		origin_x[i] = r.origin.x;
+		origin_y[i] = r.origin.y;
+		origin_z[i] = r.origin.z;
+		direction_x[i] = r.direction.x;
+		direction_y[i] = r.direction.y;
+		direction_z[i] = r.direction.z;
+		closest_t[i] = FLT_MAX;
+		primitive[i] = -1;
+		instance_primitive[i] = -1;
+
+		glm::vec3 inverse;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// keep the reciprocal finite so slab distances never become NaN
+			float d = r.direction[axis];
+			if (std::abs(d) < 1e-8f)
+				d = d < 0.0f ? -1e-8f : 1e-8f;
+
+			inverse[axis] = 1.0f / d;
+			positive[axis] |= d > 0.0f;
+			negative[axis] |= d < 0.0f;
+		}
+
+		inverse_x[i] = inverse.x;
+		inverse_y[i] = inverse.y;
+		inverse_z[i] = inverse.z;
+
+		if (i < count)
+		{
+			same_origin &= r.origin == origin;
+			inverse_min = glm::min(inverse_min, inverse);
+			inverse_max = glm::max(inverse_max, inverse);
+		}
+	}
+
+	active = count >= SIZE ? 0xffffu : (1u << count) - 1u;
+
+	// rays that spread across more than one axis get too little out of the interval test
+	int mixed_axes = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		sign[axis] = positive[axis] && negative[axis] ? 0 : (positive[axis] ? 1 : -1);
+		mixed_axes += sign[axis] == 0;
+	}
+
+	coherent = same_origin && mixed_axes <= 1;
+}
+
+bool ray_packet::cull_box(const glm::vec3& min, const glm::vec3& max, float maxT, float& nearT) const
+{
+	float enter = 0.0f;
+	float exit = maxT;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (sign[axis] == 0)
+			continue;
+
+		float near_distance = (sign[axis] > 0 ? min[axis] : max[axis]) - origin[axis];
+		float far_distance = (sign[axis] > 0 ? max[axis] : min[axis]) - origin[axis];
+
+		enter = std::max(enter, std::min(near_distance * inverse_min[axis], near_distance * inverse_max[axis]));
+		exit = std::min(exit, std::max(far_distance * inverse_min[axis], far_distance * inverse_max[axis]));
+	}
+
+	nearT = enter;
+	return enter > exit;
+}
+
+float ray_packet::max_closest_t(uint32_t mask) const
+{
+	float maxT = 0.0f;
+	for (int i = 0; i < SIZE; i++)
+	{
+		if (mask & (1u << i))
+			maxT = std::max(maxT, closest_t[i]);
+	}
+	return maxT;
+}
+
+uint32_t ray_packet::intersect_box(const glm::vec3& min, const glm::vec3& max, uint32_t mask) const
+{
+	uint32_t hits = 0;
+
+#if RT_SIMD_X86
+	__m128 min_x = _mm_set1_ps(min.x), min_y = _mm_set1_ps(min.y), min_z = _mm_set1_ps(min.z);
+	__m128 max_x = _mm_set1_ps(max.x), max_y = _mm_set1_ps(max.y), max_z = _mm_set1_ps(max.z);
+
+	for (int g = 0; g < SIZE / 4; g++)
+	{
+		if (((mask >> (4 * g)) & 0xf) == 0)
+			continue;
+
+		int lane = 4 * g;
+		__m128 o_x = _mm_load_ps(origin_x + lane), o_y = _mm_load_ps(origin_y + lane), o_z = _mm_load_ps(origin_z + lane);
+		__m128 i_x = _mm_load_ps(inverse_x + lane), i_y = _mm_load_ps(inverse_y + lane), i_z = _mm_load_ps(inverse_z + lane);
+
+		__m128 t0_x = _mm_mul_ps(_mm_sub_ps(min_x, o_x), i_x), t1_x = _mm_mul_ps(_mm_sub_ps(max_x, o_x), i_x);
+		__m128 t0_y = _mm_mul_ps(_mm_sub_ps(min_y, o_y), i_y), t1_y = _mm_mul_ps(_mm_sub_ps(max_y, o_y), i_y);
+		__m128 t0_z = _mm_mul_ps(_mm_sub_ps(min_z, o_z), i_z), t1_z = _mm_mul_ps(_mm_sub_ps(max_z, o_z), i_z);
+
+		__m128 t_near = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0_x, t1_x), _mm_min_ps(t0_y, t1_y)), _mm_max_ps(_mm_min_ps(t0_z, t1_z), _mm_setzero_ps()));
+		__m128 t_far = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0_x, t1_x), _mm_max_ps(t0_y, t1_y)), _mm_min_ps(_mm_max_ps(t0_z, t1_z), _mm_load_ps(closest_t + lane)));
+
+		hits |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(t_near, t_far)) << lane;
+	}
+#else
+	for (int i = 0; i < SIZE; i++)
+	{
+		float t0_x = (min.x - origin_x[i]) * inverse_x[i], t1_x = (max.x - origin_x[i]) * inverse_x[i];
+		float t0_y = (min.y - origin_y[i]) * inverse_y[i], t1_y = (max.y - origin_y[i]) * inverse_y[i];
+		float t0_z = (min.z - origin_z[i]) * inverse_z[i], t1_z = (max.z - origin_z[i]) * inverse_z[i];
+
+		float t_near = std::max(std::max(std::min(t0_x, t1_x), std::min(t0_y, t1_y)), std::max(std::min(t0_z, t1_z), 0.0f));
+		float t_far = std::min(std::min(std::max(t0_x, t1_x), std::max(t0_y, t1_y)), std::min(std::max(t0_z, t1_z), closest_t[i]));
+
+		hits |= (uint32_t)(t_near <= t_far) << i;
+	}
+#endif
+
+	return hits & mask;
+}
+
+void ray_packet::intersect_sphere(const glm::vec3& centre, float radius, int32_t index, float tMin, uint32_t mask)
+{
+	// same quadratic as sphere::hit, smaller root is the entry point
+#if RT_SIMD_X86
+	__m128 c_x = _mm_set1_ps(centre.x), c_y = _mm_set1_ps(centre.y), c_z = _mm_set1_ps(centre.z);
+	__m128 r2 = _mm_set1_ps(radius * radius);
+	__m128 t_min = _mm_set1_ps(tMin);
+	__m128 index_lanes = _mm_castsi128_ps(_mm_set1_epi32(index));
+
+	for (int g = 0; g < SIZE / 4; g++)
+	{
+		if (((mask >> (4 * g)) & 0xf) == 0)
+			continue;
+
+		int lane = 4 * g;
+		__m128 d_x = _mm_load_ps(direction_x + lane), d_y = _mm_load_ps(direction_y + lane), d_z = _mm_load_ps(direction_z + lane);
+		__m128 oc_x = _mm_sub_ps(_mm_load_ps(origin_x + lane), c_x);
+		__m128 oc_y = _mm_sub_ps(_mm_load_ps(origin_y + lane), c_y);
+		__m128 oc_z = _mm_sub_ps(_mm_load_ps(origin_z + lane), c_z);
+
+		__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d_x, d_x), _mm_mul_ps(d_y, d_y)), _mm_mul_ps(d_z, d_z));
+		__m128 half_b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d_x, oc_x), _mm_mul_ps(d_y, oc_y)), _mm_mul_ps(d_z, oc_z));
+		__m128 b = _mm_add_ps(half_b, half_b);
+		__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(oc_x, oc_x), _mm_mul_ps(oc_y, oc_y)), _mm_mul_ps(oc_z, oc_z)), r2);
+		__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f), a), c));
+
+		__m128 root = _mm_or_ps(_mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps())), _mm_and_ps(b, _mm_set1_ps(-0.0f)));
+		__m128 q = _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_add_ps(b, root));
+		__m128 t = _mm_min_ps(_mm_div_ps(q, a), _mm_div_ps(c, q));
+
+		__m128 closest = _mm_load_ps(closest_t + lane);
+		__m128 hit = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(discriminant, _mm_setzero_ps()), lane_mask(mask, g)),
+			_mm_and_ps(_mm_cmpge_ps(t, t_min), _mm_cmplt_ps(t, closest)));
+
+		_mm_store_ps(closest_t + lane, select(hit, t, closest));
+		_mm_store_ps((float*)primitive + lane, select(hit, index_lanes, _mm_load_ps((const float*)primitive + lane)));
+	}
+#else
+	for (int i = 0; i < SIZE; i++)
+	{
+		if (!(mask & (1u << i)))
+			continue;
+
+		glm::vec3 d{ direction_x[i], direction_y[i], direction_z[i] };
+		glm::vec3 oc = glm::vec3(origin_x[i], origin_y[i], origin_z[i]) - centre;
+
+		float a = glm::dot(d, d);
+		float b = 2.0f * glm::dot(d, oc);
+		float c = glm::dot(oc, oc) - radius * radius;
+		float discriminant = b * b - 4.0f * a * c;
+		if (discriminant < 0.0f)
+			continue;
+
+		float q = (b > 0) ? -0.5f * (b + std::sqrt(discriminant)) : -0.5f * (b - std::sqrt(discriminant));
+		float t = std::min(q / a, c / q);
+
+		if (t >= tMin && t < closest_t[i])
+		{
+			closest_t[i] = t;
+			primitive[i] = index;
+		}
+	}
+#endif
+}
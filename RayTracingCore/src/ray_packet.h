@@ -0,0 +1,48 @@
+#pragma once
+#include "ray.h"
+#include "simd.h"
+#include <cstdint>
+
+// Sixteen rays traced together as structure of arrays, each test runs across all of them at once.
+// Lanes past the number of loaded rays are never active.
+struct alignas(64) ray_packet
+{
+	static constexpr int SIZE{ 16 };
+
+	float origin_x[SIZE];
+	float origin_y[SIZE];
+	float origin_z[SIZE];
+	float direction_x[SIZE];
+	float direction_y[SIZE];
+	float direction_z[SIZE];
+	float inverse_x[SIZE];
+	float inverse_y[SIZE];
+	float inverse_z[SIZE];
+
+	float closest_t[SIZE];
+	int32_t primitive[SIZE];
+	int32_t instance_primitive[SIZE]; // of the geometry, where primitive is an instance
+
+	uint32_t active{ 0 };
+
+	// Interval bounds over the whole packet: all rays share an origin and, on every axis that isn't
+	// mixed, a direction sign, so one conservative test can reject a box for all of them.
+	glm::vec3 origin{};
+	glm::vec3 inverse_min{};
+	glm::vec3 inverse_max{};
+	int sign[3]{};		// -1 or 1, 0 when the packet points both ways along the axis
+	bool coherent{ false };
+
+	void load(const ray* rays, int count);
+
+	// lanes in mask whose ray enters the box before its closest hit
+	uint32_t intersect_box(const glm::vec3& min, const glm::vec3& max, uint32_t mask) const;
+
+	// true if no ray of the packet can enter the box before maxT, nearT is a lower bound on the entry distance
+	bool cull_box(const glm::vec3& min, const glm::vec3& max, float maxT, float& nearT) const;
+
+	// records a closer hit with the sphere in every lane of mask that has one
+	void intersect_sphere(const glm::vec3& centre, float radius, int32_t index, float tMin, uint32_t mask);
+
+	float max_closest_t(uint32_t mask) const;
+};
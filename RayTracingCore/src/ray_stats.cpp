@@ -0,0 +1,102 @@
+#include "ray_stats.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	std::mutex registryMutex;
+	std::vector<ray_stats*> registry;	// counters of every live thread that has counted something
+	ray_stats retired;					// left behind by threads that have exited
+
+	// registers the thread's counters on first use, folds them into retired when the thread exits
+	struct thread_stats
+	{
+		ray_stats stats;
+
+		thread_stats()
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			registry.push_back(&stats);
+		}
+
+		~thread_stats()
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			registry.erase(std::find(registry.begin(), registry.end(), &stats));
+			retired.merge(stats);
+		}
+	};
+}
+
+void ray_stats::merge(const ray_stats& other)
+{
+	cameraRays += other.cameraRays;
+	bounceRays += other.bounceRays;
+	shadowRays += other.shadowRays;
+
+	packets += other.packets;
+	nodesVisited += other.nodesVisited;
+	boxTests += other.boxTests;
+	primitiveTests += other.primitiveTests;
+
+	paths += other.paths;
+	pathDepth += other.pathDepth;
+	maxPathDepth = std::max(maxPathDepth, other.maxPathDepth);
+	escaped += other.escaped;
+	reachedLight += other.reachedLight;
+	absorbed += other.absorbed;
+	roulette += other.roulette;
+	depthLimit += other.depthLimit;
+}
+
+std::string ray_stats::to_json() const
+{
+	std::string json = "{";
+	auto field = [&](const char* name, uint64_t value)
+	{
+		if (json.size() > 1)
+			json += ", ";
+		json += '"' + std::string(name) + "\": " + std::to_string(value);
+	};
+
+	field("camera_rays", cameraRays);
+	field("bounce_rays", bounceRays);
+	field("shadow_rays", shadowRays);
+	field("packets", packets);
+	field("nodes_visited", nodesVisited);
+	field("box_tests", boxTests);
+	field("primitive_tests", primitiveTests);
+	field("paths", paths);
+	field("path_depth", pathDepth);
+	field("max_path_depth", maxPathDepth);
+	field("escaped", escaped);
+	field("reached_light", reachedLight);
+	field("absorbed", absorbed);
+	field("roulette", roulette);
+	field("depth_limit", depthLimit);
+
+	return json + "}";
+}
+
+ray_stats& ray_stats::local()
+{
+	thread_local thread_stats counters;
+	return counters.stats;
+}
+
+ray_stats ray_stats::collect()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	ray_stats total = retired;
+	retired = {};
+
+	for (ray_stats* stats : registry)
+	{
+		total.merge(*stats);
+		*stats = {};
+	}
+
+	return total;
+}
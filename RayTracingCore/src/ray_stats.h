@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+// Counters of where a frame's work went. Every thread counts into its own block without synchronising,
+// the renderer merges and resets all of them once per frame with collect().
+// Counting is compiled in with RT_RAY_STATS, without it the RT_STAT macros expand to nothing.
+// Rays are counted by the renderer, traversal work by the scene and BVHs, paths where they end.
+struct ray_stats
+{
+#ifdef RT_RAY_STATS
+	static constexpr bool ENABLED{ true };
+#else
+	static constexpr bool ENABLED{ false };
+#endif
+
+	// rays by what the renderer cast them for
+	uint64_t cameraRays{ 0 };
+	uint64_t bounceRays{ 0 };
+	uint64_t shadowRays{ 0 };
+
+	// traversal work
+	uint64_t packets{ 0 };			// coherent packet traversals, their rays are counted above
+	uint64_t nodesVisited{ 0 };
+	uint64_t boxTests{ 0 };			// extent::hit calls and wide node slots tested
+	uint64_t primitiveTests{ 0 };
+
+	// paths, by how they ended
+	uint64_t paths{ 0 };
+	uint64_t pathDepth{ 0 };		// rays traced along all paths, divide by paths for the average
+	uint64_t maxPathDepth{ 0 };
+	uint64_t escaped{ 0 };			// missed everything
+	uint64_t reachedLight{ 0 };		// hit an emitter
+	uint64_t absorbed{ 0 };			// the material didn't scatter
+	uint64_t roulette{ 0 };			// ended by russian roulette
+	uint64_t depthLimit{ 0 };		// still going at the bounce cap
+
+	uint64_t rays() const { return cameraRays + bounceRays + shadowRays; }
+
+	void merge(const ray_stats& other);
+
+	void end_path(uint64_t ray_stats::* reason, uint64_t depth)
+	{
+		this->*reason += 1;
+		paths++;
+		pathDepth += depth;
+		maxPathDepth = std::max(maxPathDepth, depth);
+	}
+
+	// one JSON object with every counter
+	std::string to_json() const;
+
+	// the calling thread's counters
+	static ray_stats& local();
+
+	// sum of every thread's counters since the last call, which resets them.
+	// Only call while no other thread is counting, between frames
+	static ray_stats collect();
+};
+
+#ifdef RT_RAY_STATS
+#define RT_STAT(counter, amount) (ray_stats::local().counter += (amount))
+#define RT_STAT_PATH(reason, depth) (ray_stats::local().end_path(&ray_stats::reason, (uint64_t)(depth)))
+#else
+#define RT_STAT(counter, amount) ((void)0)
+#define RT_STAT_PATH(reason, depth) ((void)0)
+#endif
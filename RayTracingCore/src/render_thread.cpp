@@ -0,0 +1,120 @@
+#include "render_thread.h"
+#include <chrono>
+
+render_thread::render_thread()
+	: m_requests(request{ camera(45.0f, 0.1f, 100.0f), {}, 0, 0 }), m_thread(&render_thread::run, this)
+{
+}
+
+render_thread::~render_thread()
+{
+	m_stop = true;
+	m_cancel = true;
+	m_thread.join();
+}
+
+void render_thread::submit_scene(const scene& scene, bool meshesChanged)
+{
+	if (meshesChanged)
+		m_meshesStale = { true, true };
+
+	// a copy the render thread hasn't taken yet is simply written again, otherwise it let go of the other one
+	int target = m_pendingScene.exchange(-1);
+	if (target < 0)
+		target = m_publishedScene < 0 ? 0 : 1 - m_publishedScene;
+
+	m_scenes[target].copyFrom(scene, m_meshesStale[target]);
+	m_meshesStale[target] = false;
+
+	m_publishedScene = target;
+	m_pendingScene = target;
+	m_cancel = true;
+}
+
+void render_thread::submit_view(const camera& camera, const renderer::settings& settings, uint32_t width, uint32_t height, bool restart)
+{
+	restart |= width != m_submittedWidth || height != m_submittedHeight;
+	m_submittedWidth = width;
+	m_submittedHeight = height;
+
+	bool moved = m_submittedCamera && !m_submittedCamera->hasSameView(camera);
+	m_submittedCamera = camera;
+
+	m_requests.write_slot() = { camera, settings, width, height };
+	m_requests.publish();
+
+	// only set once the request is out, so the frame it cancels is never restarted with the old one
+	if (restart)
+		m_restart = true;
+	if (restart || moved)
+		m_cancel = true;
+}
+
+void render_thread::run()
+{
+	bool restart = true;
+
+	while (!m_stop)
+	{
+		// cleared before anything new is picked up, so whatever is submitted from here on cancels the next frame
+		m_cancel = false;
+		restart |= m_restart.exchange(false);
+
+		int taken = m_pendingScene.exchange(-1);
+		if (taken >= 0)
+		{
+			m_tracedScene = taken;
+			restart = true;
+		}
+
+		m_requests.update();
+		const request& current = m_requests.read_slot();
+
+		// nothing to draw until the UI has sent a scene and has a viewport
+		if (m_tracedScene < 0 || current.width == 0 || current.height == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		m_renderer.getSettings() = current.settings;
+		m_renderer.onResize(current.width, current.height);
+		if (restart)
+			m_renderer.resetFrameIndex();
+
+		auto start = std::chrono::steady_clock::now();
+
+		// a cancelled frame is only shown if it started from reprojected history, its framebuffer then already
+		// shows the new view, so the image follows a camera that moves faster than whole frames finish
+		restart = false;
+		if (!m_renderer.render(m_scenes[m_tracedScene], current.view, &m_cancel) && !m_renderer.isReprojected())
+			continue;
+
+		publish_frame(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+}
+
+void render_thread::publish_frame(float renderMs)
+{
+	const framebuffer& framebuffer = m_renderer.getFramebuffer();
+	const tile_scheduler& scheduler = m_renderer.getScheduler();
+
+	frame& frame = m_frames.write_slot();
+	frame.rgba = framebuffer.get_rgba();
+	frame.width = framebuffer.get_width();
+	frame.height = framebuffer.get_height();
+	frame.samples = m_renderer.getSampleCount();
+	frame.renderMs = renderMs;
+	frame.denoiseMs = m_renderer.getDenoiseMs();
+
+	frame.activePixels = m_renderer.getActivePixelCount();
+	frame.reprojectedPixels = m_renderer.getReprojectedPixelCount();
+	frame.rayStats = m_renderer.getRayStats();
+	frame.traversalHistogram = m_renderer.getTraversalHistogram();
+
+	frame.tileStats = scheduler.get_stats();
+	frame.tileCount = scheduler.get_tiles().size();
+	frame.threadCount = scheduler.get_thread_count();
+
+	m_frames.publish();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "renderer.h"
+#include "triple_buffer.h"
+#include <array>
+#include <atomic>
+#include <thread>
+
+// Renders frame after frame on a thread of its own, so the UI runs at display rate whatever a frame costs.
+// The thread only traces its own copies of the scene: the UI keeps editing its scene and copies it into
+// whichever of the two copies the thread isn't tracing. The camera and settings go over in a triple buffer
+// every UI frame and finished frames come back in another, so neither side waits for the other. A restart
+// cancels the frame in progress between tiles instead of letting a stale image finish.
+class render_thread
+{
+public:
+	// a finished frame and what the renderer measured while making it
+	struct frame
+	{
+		std::vector<uint32_t> rgba{};
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		uint32_t samples{ 0 }; // accumulated into every pixel so far
+		float renderMs{ 0.0f };
+		float denoiseMs{ 0.0f }; // part of renderMs
+
+		uint32_t activePixels{ 0 };
+		uint32_t reprojectedPixels{ 0 }; // kept their samples through the last camera move
+		ray_stats rayStats{};
+		renderer::traversal_histogram traversalHistogram{};
+
+		tile_scheduler::frame_stats tileStats{};
+		size_t tileCount{ 0 };
+		uint32_t threadCount{ 0 };
+	};
+
+	render_thread();
+	~render_thread();
+
+	render_thread(const render_thread&) = delete;
+	render_thread& operator=(const render_thread&) = delete;
+
+	// Everything below is called from the UI thread only.
+
+	// copies the scene, which must have its BVH built, for the frames from now on and restarts the accumulation.
+	// Pass meshesChanged after adding, removing or reshaping meshes, it is cheaper to skip them otherwise
+	void submit_scene(const scene& scene, bool meshesChanged);
+
+	// the camera must already be sized to width by height. restart drops the accumulated samples and cancels
+	// the frame in progress, pass it when a setting changed what the image converges to. A new size always
+	// restarts. A moved camera cancels the frame in progress too, the renderer then restarts the accumulation
+	// or reprojects it
+	void submit_view(const camera& camera, const renderer::settings& settings, uint32_t width, uint32_t height, bool restart);
+
+	// true if a frame finished since the last call, get_frame() is then the newest one. Never waits
+	bool acquire_frame() { return m_frames.update(); }
+	const frame& get_frame() const { return m_frames.read_slot(); }
+
+private:
+	struct request
+	{
+		camera view;
+		renderer::settings settings;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	renderer m_renderer; // only touched by the render thread
+
+	// The two scene copies. Each is owned by the UI, sits in m_pendingScene waiting to be taken, or is the one
+	// being traced, and the render thread only takes a pending copy between frames, once it is done with the
+	// other. So whichever copy the UI gets back from m_pendingScene, or else the one it didn't publish last,
+	// is free to be written
+	std::array<scene, 2> m_scenes{};
+	std::atomic<int> m_pendingScene{ -1 };
+	int m_publishedScene{ -1 };						// UI side
+	std::array<bool, 2> m_meshesStale{ true, true };	// UI side, the copy's meshes are behind the UI's
+	int m_tracedScene{ -1 };						// render thread side
+
+	triple_buffer<request> m_requests;
+	triple_buffer<frame> m_frames;
+	uint32_t m_submittedWidth{ 0 };		// UI side
+	uint32_t m_submittedHeight{ 0 };
+	std::optional<camera> m_submittedCamera{};
+
+	std::atomic<bool> m_restart{ false };
+	std::atomic<bool> m_cancel{ false };
+	std::atomic<bool> m_stop{ false };
+	std::thread m_thread; // last, so it starts once everything it uses is constructed
+
+	void run();
+	void publish_frame(float renderMs);
+};
@@ -0,0 +1,835 @@
+#include "renderer.h"
+#include <chrono>
+
+namespace utils
+{
+	static uint32_t convertToRGBA(const glm::vec4& color)
+	{
+		auto r = (uint8_t)(color.r * 255.0f);
+		auto g = (uint8_t)(color.g * 255.0f);
+		auto b = (uint8_t)(color.b * 255.0f);
+		auto a = (uint8_t)(color.a * 255.0f);
+
+		uint32_t result = a << 24 | b << 16 | g << 8 | r;
+		return result;
+	}
+
+	static float powerHeuristic(float pdf, float otherPdf)
+	{
+		float a = pdf * pdf;
+		float b = otherPdf * otherPdf;
+		return a + b > 0.0f ? a / (a + b) : 0.0f;
+	}
+
+	// cold to hot: dark blue, blue, green, yellow, red
+	static glm::vec3 heatRamp(float t)
+	{
+		static const glm::vec3 stops[] = {
+			{ 0.0f, 0.0f, 0.3f },
+			{ 0.0f, 0.3f, 1.0f },
+			{ 0.0f, 0.9f, 0.3f },
+			{ 1.0f, 0.9f, 0.0f },
+			{ 1.0f, 0.0f, 0.0f }
+		};
+		constexpr int LAST{ 4 };
+
+		float position = glm::clamp(t, 0.0f, 1.0f) * LAST;
+		int stop = std::min((int)position, LAST - 1);
+		return glm::mix(stops[stop], stops[stop + 1], position - stop);
+	}
+
+	static framebuffer::aov scaleAOV(const framebuffer::aov& aov, float scale)
+	{
+		return { aov.albedo * scale, aov.normal * scale, aov.depth * scale };
+	}
+
+	static const framebuffer::aov ZERO_AOV{ glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+}
+
+void renderer::onResize(uint32_t width, uint32_t height)
+{
+	// no resize necessary
+	if (m_framebuffer.get_width() == width && m_framebuffer.get_height() == height)
+	{
+		return;
+	}
+
+	m_framebuffer.resize(width, height);
+	m_accumulationData.resize(width * height);
+	m_aovAccumulation.resize(width * height);
+	m_pixelStats.resize(width * height);
+	m_traversalCost.resize(width * height);
+	m_frameIndex = 1;
+}
+
+bool renderer::render(const scene& scene, const camera& camera, const std::atomic<bool>* cancel)
+{
+	m_activeCamera = &camera;
+	m_activeScene = &scene;
+
+	m_scheduler.configure(m_framebuffer.get_width(), m_framebuffer.get_height(), m_settings.scheduler);
+
+	bool reprojecting = m_settings.reproject && m_settings.accumulate;
+	m_reprojected = false;
+	if (m_accumulationCamera && !m_accumulationCamera->hasSameView(camera) && m_frameIndex > 1)
+	{
+		if (reprojecting && m_hasFirstHits)
+		{
+			reprojectAccumulation(*m_accumulationCamera);
+			m_reprojected = true;
+		}
+		else
+		{
+			m_frameIndex = 1;
+		}
+	}
+	m_accumulationCamera = camera;
+
+	if (m_frameIndex == 1)
+	{
+		std::fill(m_accumulationData.begin(), m_accumulationData.end(), glm::vec4(0.0f));
+		std::fill(m_pixelStats.begin(), m_pixelStats.end(), pixel_stats{});
+		std::fill(m_aovAccumulation.begin(), m_aovAccumulation.end(), utils::ZERO_AOV);
+		m_hasFirstHits = false;
+	}
+
+	// the next move is matched against these
+	if (reprojecting && !m_hasFirstHits)
+	{
+		traceFirstHits(m_firstHits);
+		m_hasFirstHits = true;
+	}
+
+	m_activePixels.store(0, std::memory_order_relaxed);
+	m_denoiseMs = 0.0f;
+
+	// render every pixel, one tile per task
+	m_scheduler.run([this, cancel](const tile_scheduler::tile& tile)
+	{
+		if (cancel && cancel->load(std::memory_order_relaxed))
+			return;
+
+		uint32_t active;
+		if (m_settings.debugView != debug_view::none)
+			active = renderTileHeatmap(tile);
+		else if (m_settings.integrator == integrator_mode::wavefront)
+			active = renderTileWavefront(tile);
+		else
+			active = renderTile(tile);
+
+		m_activePixels.fetch_add(active, std::memory_order_relaxed);
+	});
+
+	// the workers are idle again, so their counters can be gathered. A cancelled frame's are dropped with it
+	ray_stats stats = ray_stats::collect();
+
+	if (cancel && cancel->load(std::memory_order_relaxed))
+	{
+		// the next frame takes new random numbers even for the pixels this one already sampled
+		if (m_settings.accumulate)
+			m_frameIndex++;
+
+		return false;
+	}
+
+	m_rayStats = stats;
+
+	if (m_settings.debugView != debug_view::none)
+	{
+		buildTraversalHistogram();
+		m_showsDenoised = false;
+	}
+	else if (m_settings.denoise)
+	{
+		denoiseFramebuffer();
+	}
+	else if (m_showsDenoised)
+	{
+		resolveFramebuffer();
+	}
+
+	m_frameCount++;
+
+	if (m_settings.accumulate)
+	{
+		m_frameIndex++;
+	}
+	else 
+	{
+		m_frameIndex = 1;
+	}
+
+	return true;
+}
+
+sampler renderer::makeSampler(uint32_t x, uint32_t y) const
+{
+	// an accumulated image only depends on the seed and its frame number
+	uint32_t frame = m_settings.accumulate ? m_frameIndex : m_frameCount;
+	return sampler(m_settings.seed, y * m_framebuffer.get_width() + x, frame);
+}
+
+ray renderer::makeCameraRay(uint32_t x, uint32_t y, sampler& rng) const
+{
+	RT_STAT(cameraRays, 1);
+	return { m_activeCamera->getPosition(), normalize(m_activeCamera->getRayDirection(x, y, rng)) };
+}
+
+glm::vec3 renderer::missRadiance(const ray& ray) const
+{
+	if (m_settings.skybox)
+	{
+		return scene::getSkyColour(ray);
+	}
+
+	return m_activeScene->backgroundColour;
+}
+
+framebuffer::aov renderer::getFirstHitAOV(const hit_info& hitInfo) const
+{
+	// lights keep white albedo, so the denoiser filters their emission as it is
+	const material& material = *m_activeScene->materials[hitInfo.materialIndex];
+	glm::vec3 albedo = glm::length(material.emitted()) > 0.0f ? glm::vec3(1.0f) : material.baseColour;
+
+	return { albedo, hitInfo.worldNormal, hitInfo.hitDistance };
+}
+
+glm::vec3 renderer::sampleDirectLight(const material& material, const ray& rayIn, const hit_info& hitInfo, sampler& rng) const
+{
+	// always draw the numbers so the rest of the path doesn't depend on whether a light was found
+	float uLight = rng.get_real();
+	glm::vec2 u = rng.get_2d();
+
+	glm::vec3 origin = hitInfo.worldPosition + 0.001f * hitInfo.worldNormal;
+	scene::light_sample sample;
+
+	if (!m_activeScene->sampleLight(origin, uLight, u, sample))
+		return glm::vec3(0.0f);
+
+	float cosTheta = glm::dot(hitInfo.worldNormal, sample.direction);
+	if (cosTheta <= 0.0f)
+		return glm::vec3(0.0f);
+
+	// stop a little short so the light itself doesn't count as an occluder
+	RT_STAT(shadowRays, 1);
+	if (m_activeScene->occluded({ origin, sample.direction }, sample.distance * 0.999f))
+		return glm::vec3(0.0f);
+
+	glm::vec3 viewDirection = -rayIn.direction;
+	glm::vec3 brdf = material.brdf(viewDirection, sample.direction, hitInfo.worldNormal);
+	float brdfPdf = material.pdf(viewDirection, sample.direction, hitInfo.worldNormal);
+
+	glm::vec3 emission = m_activeScene->materials[m_activeScene->objects[sample.objectIndex]->material_index]->emitted();
+	return emission * brdf * cosTheta * utils::powerHeuristic(sample.pdf, brdfPdf) / sample.pdf;
+}
+
+float renderer::emissionWeight(const ray& rayIn, const hit_info& hitInfo, float brdfPdf) const
+{
+	// camera rays can't be light sampled, so they keep the whole contribution
+	if (!m_settings.nextEventEstimation || brdfPdf <= 0.0f)
+		return 1.0f;
+
+	return utils::powerHeuristic(brdfPdf, m_activeScene->lightPdf(rayIn.origin, hitInfo.objectIndex));
+}
+
+bool renderer::scatterPath(const material& material, const ray& rayIn, const hit_info& hitInfo, glm::vec3& throughput, ray& rayOut, float& pdf, sampler& rng) const
+{
+	if (!material.scatter(rayIn, rayOut, hitInfo, pdf, rng))
+	{
+		return false;
+	}
+
+	glm::vec3 brdf = material.brdf(-rayIn.direction, rayOut.direction, hitInfo.worldNormal);
+	float cosTheta = glm::max(0.0f, glm::dot(hitInfo.worldNormal, rayOut.direction));
+
+	throughput *= (brdf * cosTheta) / pdf;
+	return true;
+}
+
+bool renderer::survivesRoulette(int bounce, glm::vec3& throughput, sampler& rng) const
+{
+	if (!m_settings.russianRoulette || bounce + 1 < m_settings.rouletteDepth)
+		return true;
+
+	float survival = glm::min(1.0f, glm::max(throughput.r, glm::max(throughput.g, throughput.b)));
+	if (survival >= 1.0f)
+		return true;
+
+	if (rng.get_real() >= survival)
+		return false;
+
+	throughput /= survival;
+	return true;
+}
+
+glm::vec4 renderer::shadePixel(uint32_t x, uint32_t y, framebuffer::aov& aov)
+{
+	sampler rng = makeSampler(x, y);
+	ray cameraRay = makeCameraRay(x, y, rng);
+
+	return shadePath(cameraRay, rng, nullptr, aov);
+}
+
+glm::vec4 renderer::shadePath(const ray& cameraRay, sampler& rng, const hit_info* primaryHit, framebuffer::aov& aov)
+{
+	ray currentRay = cameraRay;
+
+	glm::vec3 radiance{ 0.0f };
+	glm::vec3 throughput{ 1.0f };
+	float brdfPdf{ 0.0f }; // of the direction currentRay was sampled in, 0 for the camera ray
+
+	for (int bounce = 0; bounce < m_settings.rayDepth; bounce++)
+	{
+		RT_STAT(bounceRays, bounce > 0);
+		hit_info hitInfo = bounce == 0 && primaryHit ? *primaryHit : m_activeScene->traceRay(currentRay);
+		rng.start_bounce(bounce + 1);
+
+		if (bounce == 0)
+		{
+			aov = hitInfo.didHit() ? getFirstHitAOV(hitInfo) : framebuffer::aov{};
+		}
+
+		if (!hitInfo.didHit())
+		{
+			radiance += throughput * missRadiance(currentRay);
+			RT_STAT_PATH(escaped, bounce + 1);
+			break;
+		}
+
+		ray scatteredRay;
+		auto& material = m_activeScene->materials[hitInfo.materialIndex];
+		glm::vec3 emission = material->emitted();
+
+		if (glm::length(emission) > 0.0f)
+		{
+			radiance += throughput * emission * emissionWeight(currentRay, hitInfo, brdfPdf);
+			RT_STAT_PATH(reachedLight, bounce + 1);
+			break;
+		}
+
+		if (m_settings.nextEventEstimation)
+		{
+			radiance += throughput * sampleDirectLight(*material, currentRay, hitInfo, rng);
+		}
+
+		if (!scatterPath(*material, currentRay, hitInfo, throughput, scatteredRay, brdfPdf, rng))
+		{
+			RT_STAT_PATH(absorbed, bounce + 1);
+			break;
+		}
+
+		if (!survivesRoulette(bounce, throughput, rng))
+		{
+			RT_STAT_PATH(roulette, bounce + 1);
+			break;
+		}
+
+		if (bounce + 1 == m_settings.rayDepth)
+		{
+			RT_STAT_PATH(depthLimit, m_settings.rayDepth);
+		}
+
+		currentRay = scatteredRay;
+	}
+
+	return { radiance, 1.0f };
+}
+
+bool renderer::isConverged(const pixel_stats& stats) const
+{
+	if (!m_settings.accumulate || m_settings.noiseThreshold <= 0.0f || stats.samples < (uint32_t)std::max(2, m_settings.minSamples))
+		return false;
+
+	// standard error of the mean, relative to the pixel's brightness but absolute in dark pixels
+	float variance = stats.m2 / (stats.samples - 1);
+	float error = glm::sqrt(variance / stats.samples) / glm::max(stats.mean, 0.1f);
+
+	return error <= m_settings.noiseThreshold;
+}
+
+uint32_t renderer::renderTile(const tile_scheduler::tile& tile)
+{
+	uint32_t active = 0;
+
+	if (!m_settings.primaryPackets)
+	{
+		for (uint32_t y = tile.y0; y < tile.y1; y++)
+		{
+			for (uint32_t x = tile.x0; x < tile.x1; x++)
+			{
+				active += renderPixel(x, y);
+			}
+		}
+		return active;
+	}
+
+	// camera rays of each 4x4 block are traced as one packet, the rest of each path on its own
+	uint32_t width = m_framebuffer.get_width();
+	for (uint32_t blockY = tile.y0; blockY < tile.y1; blockY += PACKET_WIDTH)
+	{
+		for (uint32_t blockX = tile.x0; blockX < tile.x1; blockX += PACKET_WIDTH)
+		{
+			std::array<ray, ray_packet::SIZE> rays;
+			std::array<hit_info, ray_packet::SIZE> hits;
+			std::array<sampler, ray_packet::SIZE> samplers;
+			std::array<uint32_t, ray_packet::SIZE> pixels;
+			int count = 0;
+
+			for (uint32_t y = blockY; y < std::min(blockY + PACKET_WIDTH, tile.y1); y++)
+			{
+				for (uint32_t x = blockX; x < std::min(blockX + PACKET_WIDTH, tile.x1); x++)
+				{
+					uint32_t index = y * width + x;
+					if (isConverged(m_pixelStats[index]))
+						continue;
+
+					samplers[count] = makeSampler(x, y);
+					rays[count] = makeCameraRay(x, y, samplers[count]);
+					pixels[count++] = index;
+				}
+			}
+
+			if (count == 0)
+				continue;
+
+			m_activeScene->traceRayPacket(rays.data(), count, hits.data());
+
+			for (int i = 0; i < count; i++)
+			{
+				framebuffer::aov aov;
+				glm::vec4 colour = shadePath(rays[i], samplers[i], &hits[i], aov);
+				accumulatePixel(pixels[i], colour, aov);
+			}
+			active += count;
+		}
+	}
+
+	return active;
+}
+
+bool renderer::renderPixel(uint32_t x, uint32_t y)
+{
+	uint32_t index = y * m_framebuffer.get_width() + x;
+
+	if (isConverged(m_pixelStats[index]))
+	{
+		return false;
+	}
+
+	framebuffer::aov aov;
+	glm::vec4 colour = shadePixel(x, y, aov);
+	accumulatePixel(index, colour, aov);
+	return true;
+}
+
+uint32_t renderer::renderTileWavefront(const tile_scheduler::tile& tile)
+{
+	struct wavefront_buffers
+	{
+		path_queue queue;
+		path_queue next;
+		std::vector<hit_info> hits;
+		std::vector<uint32_t> byMaterial;		// queue entries that hit a surface, grouped by material
+		std::vector<uint32_t> materialOffsets;
+		std::vector<uint32_t> pixels;			// image index of each tile slot
+		std::vector<glm::vec3> radiance;
+		std::vector<framebuffer::aov> aovs;		// per slot, of the camera ray's hit
+	};
+
+	// reused by every tile this worker renders
+	thread_local wavefront_buffers buffers;
+	auto& [queue, next, hits, byMaterial, materialOffsets, pixels, radiance, aovs] = buffers;
+
+	queue.clear();
+	pixels.clear();
+	radiance.clear();
+	aovs.clear();
+
+	// camera rays for every pixel still taking samples, queued by 4x4 block so neighbours share a packet
+	uint32_t width = m_framebuffer.get_width();
+	for (uint32_t blockY = tile.y0; blockY < tile.y1; blockY += PACKET_WIDTH)
+	{
+		for (uint32_t blockX = tile.x0; blockX < tile.x1; blockX += PACKET_WIDTH)
+		{
+			for (uint32_t y = blockY; y < std::min(blockY + PACKET_WIDTH, tile.y1); y++)
+			{
+				for (uint32_t x = blockX; x < std::min(blockX + PACKET_WIDTH, tile.x1); x++)
+				{
+					uint32_t index = y * width + x;
+					if (isConverged(m_pixelStats[index]))
+						continue;
+
+					sampler rng = makeSampler(x, y);
+					ray cameraRay = makeCameraRay(x, y, rng);
+
+					queue.push(cameraRay, glm::vec3(1.0f), 0.0f, (uint32_t)pixels.size(), rng);
+					pixels.push_back(index);
+					radiance.emplace_back(0.0f);
+					aovs.emplace_back();
+				}
+			}
+		}
+	}
+
+	size_t materialCount = m_activeScene->materials.size();
+
+	for (int bounce = 0; bounce < m_settings.rayDepth && queue.size() > 0; bounce++)
+	{
+		// trace the whole queue before shading any of it
+		hits.resize(queue.size());
+		RT_STAT(bounceRays, bounce > 0 ? queue.size() : 0);
+		if (bounce == 0 && m_settings.primaryPackets)
+		{
+			for (size_t first = 0; first < queue.size(); first += ray_packet::SIZE)
+			{
+				std::array<ray, ray_packet::SIZE> rays;
+				int count = (int)std::min<size_t>(ray_packet::SIZE, queue.size() - first);
+				for (int i = 0; i < count; i++)
+				{
+					rays[i] = queue.get_ray(first + i);
+				}
+
+				m_activeScene->traceRayPacket(rays.data(), count, hits.data() + first);
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < queue.size(); i++)
+			{
+				hits[i] = m_activeScene->traceRay(queue.get_ray(i));
+			}
+		}
+
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			queue.rng[i].start_bounce(bounce + 1);
+		}
+
+		if (bounce == 0)
+		{
+			for (size_t i = 0; i < queue.size(); i++)
+			{
+				if (hits[i].didHit())
+					aovs[queue.slot[i]] = getFirstHitAOV(hits[i]);
+			}
+		}
+
+		// misses end here, hits are compacted and counting sorted by material
+		materialOffsets.assign(materialCount + 1, 0);
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			if (!hits[i].didHit())
+			{
+				radiance[queue.slot[i]] += queue.throughput[i] * missRadiance(queue.get_ray(i));
+				RT_STAT_PATH(escaped, bounce + 1);
+				continue;
+			}
+
+			materialOffsets[hits[i].materialIndex + 1]++;
+		}
+
+		for (size_t m = 0; m < materialCount; m++)
+		{
+			materialOffsets[m + 1] += materialOffsets[m];
+		}
+
+		byMaterial.resize(materialOffsets[materialCount]);
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			if (hits[i].didHit())
+			{
+				byMaterial[materialOffsets[hits[i].materialIndex]++] = (uint32_t)i;
+			}
+		}
+
+		// shade one material at a time, survivors form the next queue
+		next.clear();
+		uint32_t begin = 0;
+		for (size_t m = 0; m < materialCount; m++)
+		{
+			uint32_t end = materialOffsets[m];
+			const material& material = *m_activeScene->materials[m];
+			glm::vec3 emission = material.emitted();
+
+			for (uint32_t k = begin; k < end; k++)
+			{
+				uint32_t i = byMaterial[k];
+
+				ray pathRay = queue.get_ray(i);
+
+				if (glm::length(emission) > 0.0f)
+				{
+					radiance[queue.slot[i]] += queue.throughput[i] * emission * emissionWeight(pathRay, hits[i], queue.pdf[i]);
+					RT_STAT_PATH(reachedLight, bounce + 1);
+					continue;
+				}
+
+				glm::vec3 throughput = queue.throughput[i];
+				sampler rng = queue.rng[i];
+
+				if (m_settings.nextEventEstimation)
+				{
+					radiance[queue.slot[i]] += throughput * sampleDirectLight(material, pathRay, hits[i], rng);
+				}
+
+				ray scatteredRay;
+				float pdf{};
+
+				if (!scatterPath(material, pathRay, hits[i], throughput, scatteredRay, pdf, rng))
+				{
+					RT_STAT_PATH(absorbed, bounce + 1);
+				}
+				else if (!survivesRoulette(bounce, throughput, rng))
+				{
+					RT_STAT_PATH(roulette, bounce + 1);
+				}
+				else
+				{
+					next.push(scatteredRay, throughput, pdf, queue.slot[i], rng);
+				}
+			}
+
+			begin = end;
+		}
+
+		std::swap(queue, next);
+	}
+
+	// whatever is still queued ran into the bounce cap
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		RT_STAT_PATH(depthLimit, m_settings.rayDepth);
+	}
+
+	for (size_t slot = 0; slot < pixels.size(); slot++)
+	{
+		accumulatePixel(pixels[slot], glm::vec4(radiance[slot], 1.0f), aovs[slot]);
+	}
+
+	return (uint32_t)pixels.size();
+}
+
+uint32_t renderer::renderTileHeatmap(const tile_scheduler::tile& tile)
+{
+	// the cost is read off the thread's ray counters around a single ray traversal, so every
+	// layout is measured per ray even where the integrators would trace packets
+	uint64_t ray_stats::* counter = m_settings.debugView == debug_view::traversal_nodes ? &ray_stats::nodesVisited : &ray_stats::primitiveTests;
+	ray_stats& stats = ray_stats::local();
+	float scale = 1.0f / (float)std::max(m_settings.heatmapMax, 1);
+
+	uint32_t width = m_framebuffer.get_width();
+	for (uint32_t y = tile.y0; y < tile.y1; y++)
+	{
+		for (uint32_t x = tile.x0; x < tile.x1; x++)
+		{
+			uint32_t index = y * width + x;
+			sampler rng = makeSampler(x, y);
+			ray cameraRay = makeCameraRay(x, y, rng);
+
+			uint64_t before = stats.*counter;
+			m_activeScene->traceRay(cameraRay);
+			uint32_t cost = (uint32_t)(stats.*counter - before);
+			m_traversalCost[index] = cost;
+
+			glm::vec4 colour(utils::heatRamp(cost * scale), 1.0f);
+			m_framebuffer.set_pixel(index, colour, utils::convertToRGBA(colour));
+		}
+	}
+
+	return (tile.x1 - tile.x0) * (tile.y1 - tile.y0);
+}
+
+void renderer::buildTraversalHistogram()
+{
+	traversal_histogram& histogram = m_traversalHistogram;
+	histogram = {};
+	histogram.binWidth = (float)std::max(m_settings.heatmapMax, 1) / traversal_histogram::BIN_COUNT;
+
+	uint64_t total = 0;
+	for (uint32_t cost : m_traversalCost)
+	{
+		int bin = std::min((int)(cost / histogram.binWidth), traversal_histogram::BIN_COUNT - 1);
+		histogram.bins[bin]++;
+		histogram.max = std::max(histogram.max, cost);
+		total += cost;
+	}
+
+	histogram.mean = m_traversalCost.empty() ? 0.0f : (float)total / m_traversalCost.size();
+}
+
+void renderer::traceFirstHits(std::vector<first_hit>& firstHits)
+{
+	uint32_t width = m_framebuffer.get_width();
+	firstHits.resize(m_framebuffer.size());
+
+	m_scheduler.run([&](const tile_scheduler::tile& tile)
+	{
+		for (uint32_t y = tile.y0; y < tile.y1; y++)
+		{
+			for (uint32_t x = tile.x0; x < tile.x1; x++)
+			{
+				ray centreRay{ m_activeCamera->getPosition(), m_activeCamera->getPixelDirection(x + 0.5f, y + 0.5f) };
+				hit_info hit = m_activeScene->traceRay(centreRay);
+
+				if (hit.didHit())
+					firstHits[y * width + x] = { hit.worldPosition, hit.worldNormal, hit.hitDistance };
+				else
+					firstHits[y * width + x] = { centreRay.direction, glm::vec3(0.0f), FLT_MAX };
+			}
+		}
+	});
+}
+
+bool renderer::isSameSurface(const first_hit& previousHit, const first_hit& hit, const glm::vec3& previousPosition) const
+{
+	if (previousHit.depth == FLT_MAX || hit.depth == FLT_MAX)
+		return previousHit.depth == hit.depth;
+
+	// seen from the old camera, the new hit has to be about as far away as what the old pixel saw and face the same way
+	float depth = glm::length(hit.position - previousPosition);
+	return glm::abs(depth - previousHit.depth) <= m_settings.reprojectDepthTolerance * depth
+		&& glm::dot(hit.normal, previousHit.normal) >= m_settings.reprojectNormalCosine;
+}
+
+void renderer::reprojectAccumulation(const camera& previous)
+{
+	uint32_t width = m_framebuffer.get_width();
+	uint32_t height = m_framebuffer.get_height();
+
+	traceFirstHits(m_nextFirstHits);
+	m_reprojectedData.resize(m_accumulationData.size());
+	m_reprojectedStats.resize(m_pixelStats.size());
+	m_reprojectedAOVs.resize(m_aovAccumulation.size());
+	m_reprojectedPixels.store(0, std::memory_order_relaxed);
+
+	uint32_t historyLength = (uint32_t)std::max(m_settings.historyLength, 1);
+
+	m_scheduler.run([&](const tile_scheduler::tile& tile)
+	{
+		uint32_t kept = 0;
+
+		for (uint32_t y = tile.y0; y < tile.y1; y++)
+		{
+			for (uint32_t x = tile.x0; x < tile.x1; x++)
+			{
+				uint32_t index = y * width + x;
+				const first_hit& hit = m_nextFirstHits[index];
+
+				// escaped rays are followed by direction alone, the background is infinitely far away
+				glm::vec3 direction = hit.depth == FLT_MAX ? hit.position : hit.position - previous.getPosition();
+
+				// the old pixel this one's surface was seen through, nearest rather than filtered so the image stays sharp
+				glm::vec2 pixel;
+				int64_t source = -1;
+				if (previous.getPixelAt(direction, pixel) && pixel.x >= 0.0f && pixel.y >= 0.0f && pixel.x < (float)width && pixel.y < (float)height)
+				{
+					uint32_t previousIndex = (uint32_t)pixel.y * width + (uint32_t)pixel.x;
+					if (isSameSurface(m_firstHits[previousIndex], hit, previous.getPosition()))
+						source = previousIndex;
+				}
+
+				if (source < 0 || m_pixelStats[source].samples == 0)
+				{
+					m_reprojectedData[index] = glm::vec4(0.0f);
+					m_reprojectedStats[index] = pixel_stats{};
+					m_reprojectedAOVs[index] = utils::ZERO_AOV;
+					m_framebuffer.set_pixel(index, glm::vec4(0.0f), 0);
+					m_framebuffer.set_aov(index, framebuffer::aov{});
+					continue;
+				}
+
+				// a long history is scaled down rather than cut, the mean stays and its weight drops
+				pixel_stats stats = m_pixelStats[source];
+				float weight = (float)std::min(stats.samples, historyLength) / stats.samples;
+				stats.samples = std::min(stats.samples, historyLength);
+				stats.m2 *= weight;
+
+				m_reprojectedData[index] = m_accumulationData[source] * weight;
+				m_reprojectedStats[index] = stats;
+				m_reprojectedAOVs[index] = utils::scaleAOV(m_aovAccumulation[source], weight);
+
+				// pixels that have converged take no sample this frame, so they are shown from here
+				glm::vec4 colour = m_reprojectedData[index] / (float)stats.samples;
+				m_framebuffer.set_pixel(index, colour, utils::convertToRGBA(clamp(colour, glm::vec4(0.0f), glm::vec4(1.0f))));
+				m_framebuffer.set_aov(index, utils::scaleAOV(m_reprojectedAOVs[index], 1.0f / stats.samples));
+				kept++;
+			}
+		}
+
+		m_reprojectedPixels.fetch_add(kept, std::memory_order_relaxed);
+	});
+
+	std::swap(m_accumulationData, m_reprojectedData);
+	std::swap(m_pixelStats, m_reprojectedStats);
+	std::swap(m_aovAccumulation, m_reprojectedAOVs);
+	std::swap(m_firstHits, m_nextFirstHits);
+}
+
+void renderer::accumulatePixel(uint32_t index, const glm::vec4& colour, const framebuffer::aov& aov)
+{
+	pixel_stats& stats = m_pixelStats[index];
+
+	float luminance = glm::dot(glm::vec3(colour), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	stats.samples++;
+	float delta = luminance - stats.mean;
+	stats.mean += delta / stats.samples;
+	stats.m2 += delta * (luminance - stats.mean);
+
+	m_accumulationData[index] += colour;
+	glm::vec4 accumulatedColour = m_accumulationData[index];
+	accumulatedColour /= (float)stats.samples;
+
+	m_framebuffer.set_pixel(index, accumulatedColour, utils::convertToRGBA(clamp(accumulatedColour, glm::vec4(0.0f), glm::vec4(1.0f))));
+
+	framebuffer::aov& aovSum = m_aovAccumulation[index];
+	aovSum.albedo += aov.albedo;
+	aovSum.normal += aov.normal;
+	aovSum.depth += aov.depth;
+	m_framebuffer.set_aov(index, utils::scaleAOV(aovSum, 1.0f / stats.samples));
+}
+
+glm::vec4 renderer::getAverageColour(uint32_t index) const
+{
+	uint32_t samples = m_pixelStats[index].samples;
+	return samples > 0 ? m_accumulationData[index] / (float)samples : glm::vec4(0.0f);
+}
+
+void renderer::denoiseFramebuffer()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// the framebuffer already shows the last filtered colour where pixels stopped sampling, so the input
+	// is taken from the accumulation instead
+	uint32_t size = (uint32_t)m_framebuffer.size();
+	// Each pixel's own count goes along, as adaptive sampling and reprojection leave them far apart
+	m_denoiseInput.resize(size);
+	m_denoiseSamples.resize(size);
+	for (uint32_t i = 0; i < size; i++)
+	{
+		m_denoiseInput[i] = getAverageColour(i);
+		m_denoiseSamples[i] = m_pixelStats[i].samples;
+	}
+
+	m_denoiser.run(m_denoiseInput, m_denoiseSamples, m_framebuffer.get_aovs(), m_framebuffer.get_width(), m_framebuffer.get_height(),
+		m_settings.denoising, m_denoisedColour);
+
+	for (uint32_t i = 0; i < size; i++)
+	{
+		const glm::vec4& colour = m_denoisedColour[i];
+		m_framebuffer.set_pixel(i, colour, utils::convertToRGBA(clamp(colour, glm::vec4(0.0f), glm::vec4(1.0f))));
+	}
+
+	m_showsDenoised = true;
+	m_denoiseMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void renderer::resolveFramebuffer()
+{
+	for (uint32_t i = 0; i < (uint32_t)m_framebuffer.size(); i++)
+	{
+		glm::vec4 colour = getAverageColour(i);
+		m_framebuffer.set_pixel(i, colour, utils::convertToRGBA(clamp(colour, glm::vec4(0.0f), glm::vec4(1.0f))));
+	}
+
+	m_showsDenoised = false;
+}
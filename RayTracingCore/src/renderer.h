@@ -0,0 +1,216 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "denoiser.h"
+#include "camera.h"
+#include "ray.h"
+#include "scene.h"
+#include "material.h"
+#include "BVH.h"
+#include "hit_info.h"
+#include "sampler.h"
+#include "tile_scheduler.h"
+#include "path_queue.h"
+#include "ray_stats.h"
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <execution>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <atomic>
+#include <ranges>
+
+class renderer
+{
+public:
+	void onResize(uint32_t width, uint32_t height);
+	// The accumulation belongs to the camera it started with, a camera with another view restarts it or, with
+	// settings.reproject, carries it over. Returns false if cancel was set during the frame: tiles that already
+	// started finish and keep their sample, as every pixel counts its own, and the rest are skipped
+	bool render(const scene& scene, const camera& camera, const std::atomic<bool>* cancel = nullptr);
+	void resetFrameIndex() { m_frameIndex = 1; }
+
+	// frames accumulated since the last restart, pixels carried over by reprojection may hold fewer
+	uint32_t getSampleCount() const { return m_settings.accumulate ? m_frameIndex - 1 : 1; }
+
+	// filters the framebuffer now with settings.denoising, for callers that only want the last frame denoised
+	// rather than every frame through settings.denoise
+	void denoise() { denoiseFramebuffer(); }
+
+	// resolved by every render call
+	const framebuffer& getFramebuffer() const { return m_framebuffer; }
+
+	enum class integrator_mode
+	{
+		megakernel,	// every pixel runs its whole path on its own
+		wavefront	// a tile's paths advance one bounce at a time, shaded in batches per material
+	};
+
+	// draws what a camera ray cost to trace instead of radiance, needs RT_RAY_STATS to count anything
+	enum class debug_view
+	{
+		none,
+		traversal_nodes,		// BVH nodes visited
+		traversal_primitives	// primitives intersected
+	};
+
+	struct settings
+	{
+		integrator_mode integrator{ integrator_mode::megakernel };
+		bool accumulate{ false };
+		bool skybox{ false };
+		int rayDepth{ 64 }; // hard cap on bounces, paths normally end through russian roulette well before it
+		int seed{ 0 };
+		bool primaryPackets{ true }; // trace camera rays in 4x4 packets
+		bool nextEventEstimation{ true }; // sample emissive spheres directly, weighted against BRDF samples with MIS
+
+		// from rouletteDepth bounces on, paths survive with a probability of their throughput
+		// and are reweighted by its inverse, so dim paths end early without biasing the image
+		bool russianRoulette{ true };
+		int rouletteDepth{ 3 };
+
+		// adaptive sampling, accumulated pixels whose relative error drops below the threshold stop
+		// taking samples once they have minSamples, 0 samples every pixel every frame
+		float noiseThreshold{ 0.0f };
+		int minSamples{ 16 };
+
+		// temporal reprojection, when accumulating: after a camera move each pixel whose surface was already
+		// visible keeps the samples of the pixel it was seen through, so moving doesn't drop the image back to
+		// one sample. Surfaces are matched by the first hit through the pixel centres of both views, and a
+		// pixel keeps at most historyLength samples so what the new view sees differently soon takes over
+		bool reproject{ false };
+		int historyLength{ 32 };
+		float reprojectDepthTolerance{ 0.05f };	// relative difference in distance from the old camera
+		float reprojectNormalCosine{ 0.9f };	// smallest cosine between the two normals
+
+		// filter the resolved image with the edge-avoiding à-trous denoiser, guided by the first hit AOVs.
+		// Only what is shown is filtered, the accumulation stays noisy and unbiased. The colour sigma applies
+		// at one sample per pixel and shrinks with the square root of the samples, like the noise
+		bool denoise{ false };
+		denoiser::settings denoising{};
+
+		tile_scheduler::settings scheduler{};
+
+		debug_view debugView{ debug_view::none };
+		int heatmapMax{ 64 }; // cost drawn at the hot end of the colour ramp, anything above it saturates
+	};
+
+	// per pixel cost of the last debug view frame in bins of equal width up to heatmapMax,
+	// the last bin also holds every pixel above it
+	struct traversal_histogram
+	{
+		static constexpr int BIN_COUNT{ 32 };
+
+		std::array<uint32_t, BIN_COUNT> bins{};
+		float binWidth{ 0.0f };
+		float mean{ 0.0f };
+		uint32_t max{ 0 };
+	};
+
+	settings& getSettings() { return m_settings; }
+	const tile_scheduler& getScheduler() const { return m_scheduler; }
+
+	// pixels that took a sample in the last frame
+	uint32_t getActivePixelCount() const { return m_activePixels.load(std::memory_order_relaxed); }
+
+	// pixels that kept their samples through the last camera move
+	uint32_t getReprojectedPixelCount() const { return m_reprojectedPixels.load(std::memory_order_relaxed); }
+
+	// the last frame started from samples reprojected out of another camera's view, so its framebuffer shows
+	// the new view everywhere even if it was cancelled
+	bool isReprojected() const { return m_reprojected; }
+
+	// counted during the last frame, all zero unless built with RT_RAY_STATS
+	const ray_stats& getRayStats() const { return m_rayStats; }
+
+	const traversal_histogram& getTraversalHistogram() const { return m_traversalHistogram; }
+
+	// spent denoising the last frame, 0 if it wasn't
+	float getDenoiseMs() const { return m_denoiseMs; }
+
+private:
+	framebuffer m_framebuffer{};
+	std::vector<glm::vec4> m_accumulationData{};
+	std::vector<framebuffer::aov> m_aovAccumulation{}; // sums like the colour, averaged into the framebuffer's AOVs
+
+	// running luminance mean and variance of each pixel (Welford)
+	struct pixel_stats
+	{
+		uint32_t samples;
+		float mean;
+		float m2;
+	};
+	std::vector<pixel_stats> m_pixelStats{};
+	std::atomic<uint32_t> m_activePixels{ 0 };
+
+	// what the ray through a pixel centre hit first, for the camera the accumulation belongs to
+	struct first_hit
+	{
+		glm::vec3 position; // the ray's direction where it escaped
+		glm::vec3 normal;
+		float depth; // distance from the camera, FLT_MAX where the ray escaped
+	};
+	std::vector<first_hit> m_firstHits{};
+	bool m_hasFirstHits{ false };
+	std::optional<camera> m_accumulationCamera{};
+	std::atomic<uint32_t> m_reprojectedPixels{ 0 };
+	bool m_reprojected{ false };
+
+	// filled by reprojection, then swapped with the buffers above
+	std::vector<first_hit> m_nextFirstHits{};
+	std::vector<glm::vec4> m_reprojectedData{};
+	std::vector<pixel_stats> m_reprojectedStats{};
+	std::vector<framebuffer::aov> m_reprojectedAOVs{};
+	ray_stats m_rayStats{};
+
+	std::vector<uint32_t> m_traversalCost{}; // per pixel, only written by the debug views
+	traversal_histogram m_traversalHistogram{};
+
+	denoiser m_denoiser{};
+	std::vector<glm::vec4> m_denoiseInput{};
+	std::vector<uint32_t> m_denoiseSamples{};
+	std::vector<glm::vec4> m_denoisedColour{};
+	bool m_showsDenoised{ false }; // pixels that stopped sampling still show the filtered colour
+	float m_denoiseMs{ 0.0f };
+
+	uint32_t m_frameIndex{ 1 };
+	uint32_t m_frameCount{ 0 }; // frames rendered so far, keys the noise when not accumulating
+
+	settings m_settings;
+	tile_scheduler m_scheduler;
+
+	const scene* m_activeScene{};
+	const camera* m_activeCamera{};
+
+	bool isConverged(const pixel_stats& stats) const;
+	static constexpr uint32_t PACKET_WIDTH{ 4 }; // camera ray packets cover 4x4 pixels
+
+	uint32_t renderTile(const tile_scheduler::tile& tile);
+	bool renderPixel(uint32_t x, uint32_t y);
+	uint32_t renderTileWavefront(const tile_scheduler::tile& tile);
+	uint32_t renderTileHeatmap(const tile_scheduler::tile& tile);
+	void buildTraversalHistogram();
+	void traceFirstHits(std::vector<first_hit>& firstHits);
+	void reprojectAccumulation(const camera& previous);
+	bool isSameSurface(const first_hit& previousHit, const first_hit& hit, const glm::vec3& previousPosition) const;
+	void accumulatePixel(uint32_t index, const glm::vec4& colour, const framebuffer::aov& aov);
+	glm::vec4 getAverageColour(uint32_t index) const;
+	void denoiseFramebuffer();
+	void resolveFramebuffer();
+
+	glm::vec4 shadePixel(uint32_t x, uint32_t y, framebuffer::aov& aov); // RayGen in DX and Vulkan
+	glm::vec4 shadePath(const ray& cameraRay, sampler& rng, const hit_info* primaryHit, framebuffer::aov& aov);
+
+	// shared by both integrators so they consume random numbers identically
+	sampler makeSampler(uint32_t x, uint32_t y) const;
+	ray makeCameraRay(uint32_t x, uint32_t y, sampler& rng) const;
+	glm::vec3 missRadiance(const ray& ray) const;
+	framebuffer::aov getFirstHitAOV(const hit_info& hitInfo) const;
+	bool scatterPath(const material& material, const ray& rayIn, const hit_info& hitInfo, glm::vec3& throughput, ray& rayOut, float& pdf, sampler& rng) const;
+	glm::vec3 sampleDirectLight(const material& material, const ray& rayIn, const hit_info& hitInfo, sampler& rng) const;
+	float emissionWeight(const ray& rayIn, const hit_info& hitInfo, float brdfPdf) const;
+	bool survivesRoulette(int bounce, glm::vec3& throughput, sampler& rng) const;
+
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <cstdint>
+
+// Counter-based random numbers: every value is a hash of (pixel, frame, bounce, dimension) and the seed,
+// so nothing is shared between threads and a render can be reproduced exactly from its seed.
+// A sampler is cheap to create and lives on the stack of the pixel it is sampling.
+class sampler
+{
+public:
+	sampler() = default;
+
+	sampler(uint32_t seed, uint32_t pixel, uint32_t frame)
+		: m_pixel(pixel), m_frame(frame ^ hash(seed))
+	{
+	}
+
+	// dimensions are numbered from zero again on each bounce, the camera uses bounce 0
+	void start_bounce(uint32_t bounce)
+	{
+		m_bounce = bounce;
+		m_dimension = 0;
+	}
+
+	// uniform in [0, 1)
+	float get_real()
+	{
+		return (next() >> 8) * 0x1p-24f;
+	}
+
+	glm::vec2 get_2d()
+	{
+		float u = get_real();
+		return { u, get_real() };
+	}
+
+	// uniform direction
+	glm::vec3 on_unit_sphere()
+	{
+		glm::vec2 u = get_2d();
+		float z = 1.0f - 2.0f * u.x;
+		float r = glm::sqrt(glm::max(0.0f, 1.0f - z * z));
+		float phi = glm::two_pi<float>() * u.y;
+
+		return { r * glm::cos(phi), r * glm::sin(phi), z };
+	}
+
+	// PCG hash (Jarzynski and Olano, "Hash Functions for GPU Rendering")
+	static uint32_t hash(uint32_t v)
+	{
+		uint32_t state = v * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+private:
+	uint32_t m_pixel{ 0 };
+	uint32_t m_frame{ 0 };
+	uint32_t m_bounce{ 0 };
+	uint32_t m_dimension{ 0 };
+
+	// pcg4d from the same paper, mixes all four counters into each output
+	uint32_t next()
+	{
+		uint32_t x = m_pixel * 1664525u + 1013904223u;
+		uint32_t y = m_frame * 1664525u + 1013904223u;
+		uint32_t z = m_bounce * 1664525u + 1013904223u;
+		uint32_t w = m_dimension++ * 1664525u + 1013904223u;
+
+		x += y * w; y += z * x; z += x * y; w += y * z;
+		x ^= x >> 16u; y ^= y >> 16u; z ^= z >> 16u; w ^= w >> 16u;
+		x += y * w; y += z * x; z += x * y; w += y * z;
+
+		return x ^ y ^ z ^ w;
+	}
+};
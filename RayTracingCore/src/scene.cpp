@@ -0,0 +1,383 @@
+#include "scene.h"
+#include <glm/gtc/constants.hpp>
+
+void scene::buildBVH(const BVH::build_settings& settings)
+{
+	primitives = primitive_list(objects, meshes, instances);
+	adoptBVH(std::make_unique<BVH>(primitives, settings));
+}
+
+void scene::adoptBVH(std::unique_ptr<BVH> prebuilt)
+{
+	primitives = primitive_list(objects, meshes, instances);
+	bvh = std::move(prebuilt);
+	spheres.build(*bvh, primitives);
+	buildWideBVH();
+	buildLights();
+}
+
+void scene::updateBVH(const std::vector<int>& dirtyObjects)
+{
+	if (bvh->update(primitives, dirtyObjects))
+	{
+		spheres.build(*bvh, primitives);
+		buildWideBVH();
+		buildLights();
+		return;
+	}
+
+	spheres.update(dirtyObjects);
+	buildLights();
+
+	if (bvh4)
+		bvh4->refit(*bvh, primitives, dirtyObjects);
+	if (bvh8)
+		bvh8->refit(*bvh, primitives, dirtyObjects);
+}
+
+void scene::copyFrom(const scene& source, bool copyMeshes)
+{
+	materials.clear();
+	for (const auto& material : source.materials)
+		materials.push_back(material->clone());
+
+	objects.clear();
+	for (const auto& object : source.objects)
+		objects.push_back(object->clone());
+
+	if (copyMeshes || meshes.size() != source.meshes.size())
+	{
+		meshes.clear();
+		for (const auto& mesh : source.meshes)
+			meshes.push_back(std::make_unique<triangle_mesh>(*mesh));
+	}
+	else
+	{
+		for (size_t i = 0; i < meshes.size(); i++)
+			meshes[i]->material_index = source.meshes[i]->material_index;
+	}
+
+	instances.clear();
+	for (const auto& placed : source.instances)
+		instances.push_back(std::make_unique<instance>(*placed));
+
+	backgroundColour = source.backgroundColour;
+	primitives = primitive_list(objects, meshes, instances);
+
+	bvh = source.bvh ? std::make_unique<BVH>(*source.bvh) : nullptr;
+	bvh4 = source.bvh4 ? std::make_unique<BVH4>(*source.bvh4) : nullptr;
+	bvh8 = source.bvh8 ? std::make_unique<BVH8>(*source.bvh8) : nullptr;
+
+	// the packed leaves point at the primitives they were built from, so these are packed again
+	if (bvh)
+		spheres.build(*bvh, primitives);
+
+	buildLights();
+}
+
+void scene::buildWideBVH()
+{
+	bvh4.reset();
+	bvh8.reset();
+
+	BVH::node_layout layout = BVH::resolve_layout(bvh->get_settings().layout);
+
+	if (layout == BVH::node_layout::bvh4)
+		bvh4 = std::make_unique<BVH4>(*bvh, primitives);
+	else if (layout == BVH::node_layout::bvh8)
+		bvh8 = std::make_unique<BVH8>(*bvh, primitives);
+}
+
+void scene::buildLights()
+{
+	lights.clear();
+	m_isLight.assign(objects.size(), false);
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		int materialIndex = objects[i]->material_index;
+		if (materialIndex < 0 || materialIndex >= (int)materials.size() || !dynamic_cast<const sphere*>(objects[i].get()))
+			continue;
+
+		if (glm::length(materials[materialIndex]->emitted()) > 0.0f)
+		{
+			lights.push_back((int)i);
+			m_isLight[i] = true;
+		}
+	}
+}
+
+float scene::coneDensity(const glm::vec3& origin, const sphere& light, float& cosThetaMax)
+{
+	glm::vec3 toCentre = light.position - origin;
+	float distanceSquared = glm::dot(toCentre, toCentre);
+	float radiusSquared = light.radius * light.radius;
+
+	if (distanceSquared <= radiusSquared)
+		return 0.0f;
+
+	float sinThetaMaxSquared = radiusSquared / distanceSquared;
+	cosThetaMax = glm::sqrt(glm::max(0.0f, 1.0f - sinThetaMaxSquared));
+
+	// 1 - cosThetaMax without the cancellation for small, distant lights
+	float oneMinusCos = sinThetaMaxSquared / (1.0f + cosThetaMax);
+	return 1.0f / (glm::two_pi<float>() * oneMinusCos);
+}
+
+bool scene::sampleLight(const glm::vec3& origin, float uLight, const glm::vec2& u, light_sample& sample) const
+{
+	if (lights.empty())
+		return false;
+
+	int objectIndex = lights[std::min((size_t)(uLight * lights.size()), lights.size() - 1)];
+	const sphere& light = static_cast<const sphere&>(*objects[objectIndex]);
+
+	float cosThetaMax;
+	float density = coneDensity(origin, light, cosThetaMax);
+	if (density == 0.0f)
+		return false;
+
+	// uniform in the cone around the direction to the centre
+	float cosTheta = 1.0f - u.x * (1.0f - cosThetaMax);
+	float sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta * cosTheta));
+	float phi = glm::two_pi<float>() * u.y;
+
+	glm::vec3 axis = glm::normalize(light.position - origin);
+	glm::vec3 helper = (glm::abs(axis.x) > 0.9f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+	glm::vec3 tangent = glm::normalize(glm::cross(helper, axis));
+	glm::vec3 bitangent = glm::cross(axis, tangent);
+
+	sample.direction = glm::normalize(sinTheta * glm::cos(phi) * tangent + sinTheta * glm::sin(phi) * bitangent + cosTheta * axis);
+	sample.pdf = density / lights.size();
+
+	// nearer root along the sampled direction, directions at the rim of the cone graze the sphere
+	glm::vec3 oc = origin - light.position;
+	float halfB = glm::dot(sample.direction, oc);
+	float c = glm::dot(oc, oc) - light.radius * light.radius;
+	sample.distance = -halfB - glm::sqrt(glm::max(0.0f, halfB * halfB - c));
+	sample.objectIndex = objectIndex;
+
+	return true;
+}
+
+float scene::lightPdf(const glm::vec3& origin, int objectIndex) const
+{
+	if (objectIndex < 0 || objectIndex >= (int)m_isLight.size() || !m_isLight[objectIndex])
+		return 0.0f;
+
+	float cosThetaMax;
+	return coneDensity(origin, static_cast<const sphere&>(*objects[objectIndex]), cosThetaMax) / lights.size();
+}
+
+hit_info scene::traceRay(const ray& ray) const
+{
+	if (primitives.size() == 0)
+	{
+		return hit_info{};
+	}
+
+	int closestPrimitive = -1;
+	int instancePrimitive = -1;
+	float closestT = FLT_MAX;
+
+	if (bvh8)
+		closestPrimitive = bvh8->intersect(ray, spheres, T_MIN, closestT, instancePrimitive);
+	else if (bvh4)
+		closestPrimitive = bvh4->intersect(ray, spheres, T_MIN, closestT, instancePrimitive);
+	else
+		closestPrimitive = bvh->intersect(ray, spheres, T_MIN, closestT, instancePrimitive);
+
+	if (closestPrimitive < 0)
+	{
+		return hit_info();
+	}
+
+	return makeHit(ray, closestPrimitive, closestT, instancePrimitive);
+}
+
+bool scene::occluded(const ray& ray, float tMax) const
+{
+	if (primitives.size() == 0)
+	{
+		return false;
+	}
+
+	if (bvh8)
+		return bvh8->occluded(ray, spheres, T_MIN, tMax);
+	else if (bvh4)
+		return bvh4->occluded(ray, spheres, T_MIN, tMax);
+	else
+		return bvh->occluded(ray, spheres, T_MIN, tMax);
+}
+
+void scene::traceRayPacket(const ray* rays, int count, hit_info* hits) const
+{
+	ray_packet packet;
+	packet.load(rays, count);
+
+	// rays that went different ways share too few nodes to be worth traversing together
+	if (primitives.size() == 0 || !packet.coherent)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			hits[i] = traceRay(rays[i]);
+		}
+		return;
+	}
+
+	RT_STAT(packets, 1);
+	traversePacket(packet, T_MIN);
+
+	for (int i = 0; i < count; i++)
+	{
+		hits[i] = packet.primitive[i] < 0 ? hit_info() : makeHit(rays[i], packet.primitive[i], packet.closest_t[i], packet.instance_primitive[i]);
+	}
+}
+
+void scene::traversePacket(ray_packet& packet, float tMin) const
+{
+	struct stack_entry
+	{
+		uint32_t node;
+		uint32_t mask; // rays that entered the parent
+	};
+
+	std::array<stack_entry, BVH::MAX_STACK_SIZE> stack;
+	int stackSize = 0;
+	stack[stackSize++] = { 0, packet.active };
+
+	const BVH& accel = *bvh;
+
+	while (stackSize > 0)
+	{
+		auto [nodeIndex, mask] = stack[--stackSize];
+		const BVHNode& node = accel.nodes[nodeIndex];
+		RT_STAT(nodesVisited, 1);
+
+		// leaves only store their tight slanted slabs, their primitives are tested directly
+		// packet tests are counted once per packet, not per ray
+		if (node.is_leaf())
+		{
+			RT_STAT(primitiveTests, node.count);
+			intersectPacketLeaf(packet, node, mask, tMin);
+			continue;
+		}
+
+		glm::vec3 min{ node.bounds.slabs[0].d_near, node.bounds.slabs[1].d_near, node.bounds.slabs[2].d_near };
+		glm::vec3 max{ node.bounds.slabs[0].d_far, node.bounds.slabs[1].d_far, node.bounds.slabs[2].d_far };
+
+		RT_STAT(boxTests, 1);
+		float nearT;
+		if (packet.cull_box(min, max, packet.max_closest_t(mask), nearT))
+		{
+			continue;
+		}
+
+		mask = packet.intersect_box(min, max, mask);
+		if (mask == 0)
+		{
+			continue;
+		}
+
+		// push the children far to near along the packet's direction, leaves are placed by their first primitive
+		glm::vec3 direction = glm::vec3(packet.sign[0], packet.sign[1], packet.sign[2]);
+
+		std::array<stack_entry, 8> children;
+		std::array<float, 8> distances;
+		int childCount = 0;
+
+		for (uint32_t child = node.offset; child < node.offset + node.count; child++)
+		{
+			const BVHNode& childNode = accel.nodes[child];
+
+			glm::vec3 centre;
+			if (childNode.is_leaf())
+			{
+				if (childNode.count == 0)
+					continue;
+				centre = spheres.center(childNode.offset);
+			}
+			else
+			{
+				centre = 0.5f * glm::vec3(
+					childNode.bounds.slabs[0].d_near + childNode.bounds.slabs[0].d_far,
+					childNode.bounds.slabs[1].d_near + childNode.bounds.slabs[1].d_far,
+					childNode.bounds.slabs[2].d_near + childNode.bounds.slabs[2].d_far);
+			}
+
+			float distance = glm::dot(centre - packet.origin, direction);
+
+			int j = childCount++;
+			for (; j > 0 && distances[j - 1] < distance; j--)
+			{
+				children[j] = children[j - 1];
+				distances[j] = distances[j - 1];
+			}
+			children[j] = { child, mask };
+			distances[j] = distance;
+		}
+
+		for (int i = 0; i < childCount; i++)
+		{
+			stack[stackSize++] = children[i];
+		}
+	}
+}
+
+void scene::intersectPacketLeaf(ray_packet& packet, const BVHNode& leaf, uint32_t mask, float tMin) const
+{
+	for (uint32_t p = leaf.offset; p < leaf.offset + leaf.count; p++)
+	{
+		if (spheres.is_sphere(p))
+		{
+			packet.intersect_sphere(spheres.center(p), spheres.radius[p], (int32_t)p, tMin, mask);
+			continue;
+		}
+
+		for (int i = 0; i < ray_packet::SIZE; i++)
+		{
+			if (!(mask & (1u << i)))
+				continue;
+
+			ray laneRay{ { packet.origin_x[i], packet.origin_y[i], packet.origin_z[i] }, { packet.direction_x[i], packet.direction_y[i], packet.direction_z[i] } };
+			int instancePrimitive = -1;
+			float t = spheres.hit(laneRay, p, tMin, packet.closest_t[i], instancePrimitive);
+
+			if (t >= tMin && t < packet.closest_t[i])
+			{
+				packet.closest_t[i] = t;
+				packet.primitive[i] = (int32_t)p;
+				packet.instance_primitive[i] = instancePrimitive;
+			}
+		}
+	}
+}
+
+hit_info scene::makeHit(const ray& ray, int primitive, float hitDistance, int instancePrimitive) const
+{
+	hit_info hitInfo{};
+	hitInfo.hitDistance = hitDistance;
+	hitInfo.objectIndex = spheres.object_index[primitive];
+
+	hitInfo.materialIndex = primitives.get_material(hitInfo.objectIndex);
+	hitInfo.worldPosition = ray.origin + hitDistance * ray.direction;
+
+	if (primitives.is_instance(hitInfo.objectIndex))
+	{
+		hitInfo.worldNormal = primitives.get_instance(hitInfo.objectIndex).getNormalAt(ray, instancePrimitive, hitDistance);
+	}
+	else
+	{
+		hitInfo.worldNormal = spheres.normal(primitive, hitInfo.worldPosition, ray.direction);
+	}
+
+	return hitInfo;
+}
+
+glm::vec3 scene::getSkyColour(const ray& ray)
+{
+	float t = 0.5f * (ray.direction.y + 1.0f);
+	glm::vec3 skyColour = (1.0f - t) * glm::vec3(1.0f) + t * glm::vec3(0.6f, 0.7f, 0.9f);
+
+	return skyColour;
+}
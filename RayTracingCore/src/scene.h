@@ -0,0 +1,92 @@
+#pragma once
+#include "material.h"
+#include <memory>
+#include <glm/glm.hpp>
+#include <vector>
+#include "object.h"
+#include "BVH.h"
+#include "WideBVH.h"
+#include "sphere_set.h"
+#include "instance.h"
+#include "ray_packet.h"
+#include "ray_stats.h"
+
+class scene 
+{
+public:
+	std::vector<std::unique_ptr<object>> objects{};
+	std::vector<std::unique_ptr<triangle_mesh>> meshes{};
+	std::vector<std::unique_ptr<instance>> instances{};
+	std::vector<std::unique_ptr<material>> materials{};
+	glm::vec3 backgroundColour{ 0.6f, 0.7f, 0.9f };
+
+	// objects, mesh triangles then instances, the BVH's object_indices and hit_info::objectIndex index into this
+	primitive_list primitives{};
+
+	std::unique_ptr<BVH> bvh{};
+	std::unique_ptr<BVH4> bvh4{};
+	std::unique_ptr<BVH8> bvh8{};
+	sphere_set spheres{};
+
+	// spheres with an emissive material, sampled directly by the renderer
+	std::vector<int> lights{};
+
+	struct light_sample
+	{
+		glm::vec3 direction;
+		float pdf; // per solid angle, including the choice of light
+		float distance; // to the light's surface along direction
+		int objectIndex;
+	};
+
+	// builds the BVH, the wide layout its settings ask for and the packed spheres in leaf order
+	void buildBVH(const BVH::build_settings& settings);
+
+	// takes over a BVH already built for the current objects and meshes and sets up everything derived from it
+	void adoptBVH(std::unique_ptr<BVH> prebuilt);
+
+	// refits around objects whose position, size or material changed. Instances are passed by their primitive
+	// index, moving one only touches this top-level tree and never the BVH of its geometry
+	void updateBVH(const std::vector<int>& dirtyObjects);
+
+	void buildLights();
+
+	// makes this scene a copy of source that shares nothing it could edit, so source can change while this one is
+	// traced on another thread. Instances still share their geometry, which never changes once made. Meshes are
+	// large and rarely edited, so they are only copied again when copyMeshes is set or their count differs,
+	// otherwise just their materials are. The BVH is copied as it is built and nothing is rebuilt
+	void copyFrom(const scene& source, bool copyMeshes);
+
+	// picks a light uniformly and a direction in the cone its sphere subtends from origin
+	bool sampleLight(const glm::vec3& origin, float uLight, const glm::vec2& u, light_sample& sample) const;
+
+	// density of sampleLight choosing the direction towards a point on the light
+	float lightPdf(const glm::vec3& origin, int objectIndex) const;
+
+	hit_info traceRay(const ray& ray) const;
+
+	// any-hit visibility test: true if something lies along the ray before tMax.
+	// Stops at the first hit and builds no hit_info, meant for shadow and occlusion rays
+	bool occluded(const ray& ray, float tMax) const;
+
+	// traces up to ray_packet::SIZE rays, coherent ones (camera rays) traverse the BVH together
+	void traceRayPacket(const ray* rays, int count, hit_info* hits) const;
+
+	static glm::vec3 getSkyColour(const ray& ray);
+
+private:
+	static constexpr float T_MIN{ 0.001f }; // to avoid self-intersection
+
+	void buildWideBVH();
+
+	void traversePacket(ray_packet& packet, float tMin) const;
+	void intersectPacketLeaf(ray_packet& packet, const BVHNode& leaf, uint32_t mask, float tMin) const;
+
+	// instancePrimitive is the primitive of the instance's geometry, when primitive is an instance
+	hit_info makeHit(const ray& ray, int primitive, float hitDistance, int instancePrimitive) const;
+
+	std::vector<bool> m_isLight{};
+
+	// one over the solid angle of the cone, 0 if origin is inside the sphere
+	static float coneDensity(const glm::vec3& origin, const sphere& light, float& cosThetaMax);
+};
\ No newline at end of file
@@ -0,0 +1,570 @@
+#include "scene_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <fstream>
+
+namespace
+{
+	using namespace scene_file;
+
+	// interior nodes of every build strategy have at most 8 children, traversal sorts them on the stack
+	constexpr uint32_t MAX_CHILDREN{ 8 };
+
+	uint64_t align(uint64_t offset)
+	{
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+
+	bool finite(const float* values, size_t count)
+	{
+		return std::all_of(values, values + count, [](float value) { return std::isfinite(value); });
+	}
+
+	template <typename Record>
+	const Record* records(const void* data, const section& section)
+	{
+		return reinterpret_cast<const Record*>(static_cast<const uint8_t*>(data) + section.offset);
+	}
+
+	template <typename Record>
+	bool check_section(const section& section, uint64_t fileSize, const char* name, std::string& error)
+	{
+		if (section.count == 0)
+			return true;
+
+		if (section.offset % ALIGNMENT != 0 || section.offset < sizeof(file_header) || section.offset > fileSize
+			|| section.count > (fileSize - section.offset) / sizeof(Record))
+		{
+			error = std::string(name) + " section lies outside the file";
+			return false;
+		}
+
+		return true;
+	}
+
+	bool check_header(const file_header& header, size_t size, std::string& error)
+	{
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+		{
+			error = "not a scene file";
+			return false;
+		}
+
+		if (header.version != VERSION)
+		{
+			error = "scene file version " + std::to_string(header.version) + ", this build reads version " + std::to_string(VERSION);
+			return false;
+		}
+
+		if (header.fileSize != size)
+		{
+			error = "file is " + std::to_string(size) + " bytes, its header says " + std::to_string(header.fileSize);
+			return false;
+		}
+
+		bool settingsValid = header.strategy <= (uint32_t)BVH::build_strategy::lbvh
+			&& header.layout <= (uint32_t)BVH::node_layout::bvh8
+			&& header.maxLeafSize >= 1
+			&& header.maxDepth >= 0 && header.maxDepth <= BVH::MAX_DEPTH
+			&& header.sahBins >= 2 && header.sahBins <= BVH::MAX_SAH_BINS
+			&& header.lbvhSahTop <= 1;
+		float values[] = { header.background[0], header.background[1], header.background[2],
+			header.traversalCost, header.intersectionCost, header.rebuildThreshold, header.buildCost };
+
+		if (!settingsValid || !finite(values, std::size(values)))
+		{
+			error = "invalid background or BVH settings";
+			return false;
+		}
+
+		return check_section<material_record>(header.materials, size, "material", error)
+			&& check_section<sphere_record>(header.spheres, size, "sphere", error)
+			&& check_section<node_record>(header.nodes, size, "node", error)
+			&& check_section<int32_t>(header.objectIndices, size, "object index", error)
+			&& check_section<mesh_record>(header.meshes, size, "mesh", error)
+			&& check_section<vector_record>(header.positions, size, "position", error)
+			&& check_section<vector_record>(header.normals, size, "normal", error)
+			&& check_section<uint32_t>(header.indices, size, "index", error);
+	}
+
+	bool check_meshes(view& view, std::string& error)
+	{
+		if (view.normalCount != 0 && view.normalCount != view.positionCount)
+		{
+			error = "there are normals for only some vertices";
+			return false;
+		}
+
+		const float* coordinates = &view.positions[0].x;
+		if (!std::all_of(std::execution::par, coordinates, coordinates + 3 * view.positionCount, [](float value) { return std::isfinite(value); }))
+		{
+			error = "a vertex position isn't finite";
+			return false;
+		}
+
+		view.triangleCount = 0;
+		for (size_t i = 0; i < view.meshCount; i++)
+		{
+			const mesh_record& record = view.meshes[i];
+			std::string name = "mesh " + std::to_string(i);
+
+			if (record.firstVertex > view.positionCount || record.vertexCount > view.positionCount - record.firstVertex
+				|| record.firstIndex > view.indexCount || record.indexCount > view.indexCount - record.firstIndex
+				|| record.indexCount % 3 != 0 || record.vertexCount > UINT32_MAX)
+			{
+				error = name + " lies outside the vertex or index sections";
+				return false;
+			}
+
+			if (record.materialIndex < 0 || (size_t)record.materialIndex >= view.materialCount || record.hasNormals > 1
+				|| (record.hasNormals && view.normalCount == 0))
+			{
+				error = name + " is invalid";
+				return false;
+			}
+
+			const uint32_t* indices = view.indices + record.firstIndex;
+			if (!std::all_of(std::execution::par, indices, indices + record.indexCount, [&](uint32_t index) { return index < record.vertexCount; }))
+			{
+				error = name + " indexes past its vertices";
+				return false;
+			}
+
+			view.triangleCount += (size_t)record.indexCount / 3;
+		}
+
+		return true;
+	}
+
+	bool check_tree(const view& view, std::string& error)
+	{
+		if (view.nodeCount == 0 || view.objectIndexCount != view.sphereCount + view.triangleCount)
+		{
+			error = "the BVH doesn't match the objects";
+			return false;
+		}
+
+		// parents are stored before their children, so one pass in order sees every node after the
+		// node that references it, with its depth and the stack entries pending above it known
+		struct node_state
+		{
+			uint32_t depth;
+			uint32_t pending;
+			bool reached;
+		};
+		std::vector<node_state> states(view.nodeCount, node_state{ 0, 1, false });
+		states[0].reached = true;
+
+		std::vector<bool> covered(view.objectIndexCount, false);
+
+		for (size_t i = 0; i < view.nodeCount; i++)
+		{
+			const node_record& node = view.nodes[i];
+			const node_state& state = states[i];
+			std::string name = "node " + std::to_string(i);
+
+			if (!state.reached)
+			{
+				error = name + " isn't referenced by any other";
+				return false;
+			}
+
+			bool boundsValid = std::none_of(node.slabNear, node.slabNear + 7, [](float d) { return std::isnan(d); })
+				&& std::none_of(node.slabFar, node.slabFar + 7, [](float d) { return std::isnan(d); })
+				&& node.activeSlabs < (1u << 7) && std::isfinite(node.area);
+
+			if (!boundsValid || node.leaf > 1)
+			{
+				error = name + " has invalid bounds";
+				return false;
+			}
+
+			if (node.leaf)
+			{
+				if ((uint64_t)node.offset + node.count > view.objectIndexCount)
+				{
+					error = name + " covers objects past the end";
+					return false;
+				}
+
+				for (uint32_t entry = node.offset; entry < node.offset + node.count; entry++)
+				{
+					if (covered[entry])
+					{
+						error = name + " shares its objects with another leaf";
+						return false;
+					}
+					covered[entry] = true;
+				}
+				continue;
+			}
+
+			if (node.count == 0 || node.count > MAX_CHILDREN || node.offset <= i || (uint64_t)node.offset + node.count > view.nodeCount)
+			{
+				error = name + " has invalid children";
+				return false;
+			}
+
+			for (uint32_t child = node.offset; child < node.offset + node.count; child++)
+			{
+				node_state& childState = states[child];
+				if (childState.reached)
+				{
+					error = "node " + std::to_string(child) + " has more than one parent";
+					return false;
+				}
+
+				childState = { state.depth + 1, state.pending + node.count - 1, true };
+				if (childState.depth > (uint32_t)BVH::MAX_DEPTH || childState.pending > (uint32_t)BVH::MAX_STACK_SIZE)
+				{
+					error = "the BVH is too deep to traverse";
+					return false;
+				}
+			}
+		}
+
+		if (std::find(covered.begin(), covered.end(), false) != covered.end())
+		{
+			error = "the BVH's leaves don't cover every object";
+			return false;
+		}
+
+		// each object and triangle once
+		std::vector<bool> seen(view.objectIndexCount, false);
+		for (size_t i = 0; i < view.objectIndexCount; i++)
+		{
+			int32_t objectIndex = view.objectIndices[i];
+			if (objectIndex < 0 || (size_t)objectIndex >= view.objectIndexCount || seen[objectIndex])
+			{
+				error = "the BVH doesn't reference every object exactly once";
+				return false;
+			}
+			seen[objectIndex] = true;
+		}
+
+		return true;
+	}
+}
+
+bool scene_file::validate(const void* data, size_t size, std::string& error)
+{
+	view view;
+	return open_view(data, size, view, error);
+}
+
+bool scene_file::open_view(const void* data, size_t size, view& view, std::string& error)
+{
+	if (size < sizeof(file_header))
+	{
+		error = "file is too small for a scene file header";
+		return false;
+	}
+
+	if ((uintptr_t)data % alignof(file_header) != 0)
+	{
+		error = "file data isn't aligned for reading in place";
+		return false;
+	}
+
+	const file_header& header = *static_cast<const file_header*>(data);
+	if (!check_header(header, size, error))
+		return false;
+
+	view.header = &header;
+	view.materials = records<material_record>(data, header.materials);
+	view.spheres = records<sphere_record>(data, header.spheres);
+	view.nodes = records<node_record>(data, header.nodes);
+	view.objectIndices = records<int32_t>(data, header.objectIndices);
+	view.materialCount = (size_t)header.materials.count;
+	view.sphereCount = (size_t)header.spheres.count;
+	view.nodeCount = (size_t)header.nodes.count;
+	view.objectIndexCount = (size_t)header.objectIndices.count;
+	view.meshes = records<mesh_record>(data, header.meshes);
+	view.positions = records<vector_record>(data, header.positions);
+	view.normals = records<vector_record>(data, header.normals);
+	view.indices = records<uint32_t>(data, header.indices);
+	view.meshCount = (size_t)header.meshes.count;
+	view.positionCount = (size_t)header.positions.count;
+	view.normalCount = (size_t)header.normals.count;
+	view.indexCount = (size_t)header.indices.count;
+
+	for (size_t i = 0; i < view.materialCount; i++)
+	{
+		const material_record& record = view.materials[i];
+		float values[] = { record.baseColour[0], record.baseColour[1], record.baseColour[2], record.roughness, record.metallic, record.specular, record.emissionStrength };
+
+		if (record.type > material_type::emissive || !finite(values, std::size(values)))
+		{
+			error = "material " + std::to_string(i) + " is invalid";
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < view.sphereCount; i++)
+	{
+		const sphere_record& record = view.spheres[i];
+		float values[] = { record.position[0], record.position[1], record.position[2], record.radius };
+
+		if (!finite(values, std::size(values)) || record.radius < 0.0f || record.materialIndex < 0 || (size_t)record.materialIndex >= view.materialCount)
+		{
+			error = "sphere " + std::to_string(i) + " is invalid";
+			return false;
+		}
+	}
+
+	return check_meshes(view, error) && check_tree(view, error);
+}
+
+bool scene_file::write(const scene& scene, const std::string& path)
+{
+	if (!scene.bvh || !scene.instances.empty())
+		return false;
+
+	const BVH& bvh = *scene.bvh;
+
+	std::vector<material_record> materials;
+	materials.reserve(scene.materials.size());
+	for (const auto& material : scene.materials)
+	{
+		const auto* light = dynamic_cast<const emissive*>(material.get());
+		materials.push_back({
+			light ? material_type::emissive : material_type::standard,
+			{ material->baseColour.r, material->baseColour.g, material->baseColour.b },
+			material->roughness, material->metallic, material->specular,
+			light ? light->emissionStrength : 0.0f });
+	}
+
+	std::vector<sphere_record> spheres;
+	spheres.reserve(scene.objects.size());
+	for (const auto& object : scene.objects)
+	{
+		const auto* ball = dynamic_cast<const sphere*>(object.get());
+		if (!ball)
+			return false;
+
+		spheres.push_back({ { ball->position.x, ball->position.y, ball->position.z }, ball->radius, ball->material_index });
+	}
+
+	std::vector<mesh_record> meshes;
+	std::vector<vector_record> positions;
+	std::vector<vector_record> normals;
+	std::vector<uint32_t> indices;
+
+	bool anyNormals = std::any_of(scene.meshes.begin(), scene.meshes.end(), [](const auto& mesh) { return !mesh->normals.empty(); });
+	for (const auto& mesh : scene.meshes)
+	{
+		meshes.push_back({ positions.size(), mesh->positions.size(), indices.size(), mesh->indices.size(), mesh->material_index, !mesh->normals.empty() });
+
+		for (size_t i = 0; i < mesh->positions.size(); i++)
+		{
+			positions.push_back({ mesh->positions[i].x, mesh->positions[i].y, mesh->positions[i].z });
+			if (anyNormals)
+				normals.push_back(mesh->normals.empty() ? vector_record{} : vector_record{ mesh->normals[i].x, mesh->normals[i].y, mesh->normals[i].z });
+		}
+		indices.insert(indices.end(), mesh->indices.begin(), mesh->indices.end());
+	}
+
+	std::vector<node_record> nodes(bvh.nodes.size());
+	std::transform(std::execution::par, bvh.nodes.begin(), bvh.nodes.end(), nodes.begin(), [](const BVHNode& node)
+	{
+		node_record record{};
+		for (int i = 0; i < 7; i++)
+		{
+			record.slabNear[i] = node.bounds.slabs[i].d_near;
+			record.slabFar[i] = node.bounds.slabs[i].d_far;
+		}
+		record.activeSlabs = (uint32_t)node.bounds.active.to_ulong();
+		record.offset = node.offset;
+		record.count = node.count;
+		record.parent = node.parent;
+		record.area = node.area;
+		record.leaf = node.leaf;
+		return record;
+	});
+
+	const BVH::build_settings& settings = bvh.get_settings();
+
+	file_header header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.background[0] = scene.backgroundColour.r;
+	header.background[1] = scene.backgroundColour.g;
+	header.background[2] = scene.backgroundColour.b;
+	header.strategy = (uint32_t)settings.strategy;
+	header.layout = (uint32_t)settings.layout;
+	header.maxLeafSize = settings.max_leaf_size;
+	header.maxDepth = settings.max_depth;
+	header.sahBins = settings.sah_bins;
+	header.traversalCost = settings.traversal_cost;
+	header.intersectionCost = settings.intersection_cost;
+	header.lbvhSahTop = settings.lbvh_sah_top;
+	header.rebuildThreshold = settings.rebuild_threshold;
+	header.buildCost = bvh.get_build_cost();
+
+	uint64_t offset = align(sizeof(file_header));
+	auto place = [&offset](section& section, size_t count, size_t recordSize)
+	{
+		section = { offset, count };
+		offset = align(offset + count * recordSize);
+	};
+
+	place(header.materials, materials.size(), sizeof(material_record));
+	place(header.spheres, spheres.size(), sizeof(sphere_record));
+	place(header.nodes, nodes.size(), sizeof(node_record));
+	place(header.objectIndices, bvh.object_indices.size(), sizeof(int32_t));
+	place(header.meshes, meshes.size(), sizeof(mesh_record));
+	place(header.positions, positions.size(), sizeof(vector_record));
+	place(header.normals, normals.size(), sizeof(vector_record));
+	place(header.indices, indices.size(), sizeof(uint32_t));
+	header.fileSize = offset;
+
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream)
+		return false;
+
+	// each section is zero padded up to its offset
+	uint64_t written = 0;
+	auto put = [&](uint64_t at, const void* data, size_t bytes)
+	{
+		static const char zeros[ALIGNMENT]{};
+		stream.write(zeros, (std::streamsize)(at - written));
+		stream.write(static_cast<const char*>(data), (std::streamsize)bytes);
+		written = at + bytes;
+	};
+
+	put(0, &header, sizeof(header));
+	put(header.materials.offset, materials.data(), materials.size() * sizeof(material_record));
+	put(header.spheres.offset, spheres.data(), spheres.size() * sizeof(sphere_record));
+	put(header.nodes.offset, nodes.data(), nodes.size() * sizeof(node_record));
+	put(header.objectIndices.offset, bvh.object_indices.data(), bvh.object_indices.size() * sizeof(int32_t));
+	put(header.meshes.offset, meshes.data(), meshes.size() * sizeof(mesh_record));
+	put(header.positions.offset, positions.data(), positions.size() * sizeof(vector_record));
+	put(header.normals.offset, normals.data(), normals.size() * sizeof(vector_record));
+	put(header.indices.offset, indices.data(), indices.size() * sizeof(uint32_t));
+	put(header.fileSize, nullptr, 0);
+
+	return stream.good();
+}
+
+void scene_file::load(const view& view, scene& scene)
+{
+	const file_header& header = *view.header;
+
+	scene.objects.clear();
+	scene.meshes.clear();
+	scene.instances.clear();
+	scene.materials.clear();
+	scene.bvh.reset();
+	scene.bvh4.reset();
+	scene.bvh8.reset();
+	scene.backgroundColour = { header.background[0], header.background[1], header.background[2] };
+
+	scene.materials.reserve(view.materialCount);
+	for (size_t i = 0; i < view.materialCount; i++)
+	{
+		const material_record& record = view.materials[i];
+
+		std::unique_ptr<material> loaded;
+		if (record.type == material_type::emissive)
+		{
+			auto light = std::make_unique<emissive>();
+			light->emissionStrength = record.emissionStrength;
+			loaded = std::move(light);
+		}
+		else
+		{
+			loaded = std::make_unique<material>();
+		}
+
+		loaded->baseColour = { record.baseColour[0], record.baseColour[1], record.baseColour[2] };
+		loaded->roughness = record.roughness;
+		loaded->metallic = record.metallic;
+		loaded->specular = record.specular;
+		scene.materials.push_back(std::move(loaded));
+	}
+
+	scene.objects.reserve(view.sphereCount);
+	for (size_t i = 0; i < view.sphereCount; i++)
+	{
+		const sphere_record& record = view.spheres[i];
+
+		auto loaded = std::make_unique<sphere>();
+		loaded->position = { record.position[0], record.position[1], record.position[2] };
+		loaded->radius = record.radius;
+		loaded->material_index = record.materialIndex;
+		scene.objects.push_back(std::move(loaded));
+	}
+
+	scene.meshes.reserve(view.meshCount);
+	for (size_t i = 0; i < view.meshCount; i++)
+	{
+		const mesh_record& record = view.meshes[i];
+		auto toVector = [](const vector_record& v) { return glm::vec3(v.x, v.y, v.z); };
+
+		auto loaded = std::make_unique<triangle_mesh>();
+		loaded->positions.resize(record.vertexCount);
+		std::transform(std::execution::par, view.positions + record.firstVertex, view.positions + record.firstVertex + record.vertexCount,
+			loaded->positions.begin(), toVector);
+
+		if (record.hasNormals)
+		{
+			loaded->normals.resize(record.vertexCount);
+			std::transform(std::execution::par, view.normals + record.firstVertex, view.normals + record.firstVertex + record.vertexCount,
+				loaded->normals.begin(), toVector);
+		}
+
+		loaded->indices.assign(view.indices + record.firstIndex, view.indices + record.firstIndex + record.indexCount);
+		loaded->material_index = record.materialIndex;
+		scene.meshes.push_back(std::move(loaded));
+	}
+
+	std::vector<BVHNode> nodes(view.nodeCount);
+	std::transform(std::execution::par, view.nodes, view.nodes + view.nodeCount, nodes.begin(), [](const node_record& record)
+	{
+		BVHNode node;
+		for (int i = 0; i < 7; i++)
+		{
+			node.bounds.slabs[i] = { record.slabNear[i], record.slabFar[i] };
+		}
+		node.bounds.active = std::bitset<7>(record.activeSlabs);
+		node.offset = record.offset;
+		node.count = record.count;
+		node.parent = record.parent;
+		node.area = record.area;
+		node.leaf = record.leaf != 0;
+		return node;
+	});
+
+	BVH::build_settings settings;
+	settings.strategy = (BVH::build_strategy)header.strategy;
+	settings.layout = (BVH::node_layout)header.layout;
+	settings.max_leaf_size = header.maxLeafSize;
+	settings.max_depth = header.maxDepth;
+	settings.sah_bins = header.sahBins;
+	settings.traversal_cost = header.traversalCost;
+	settings.intersection_cost = header.intersectionCost;
+	settings.lbvh_sah_top = header.lbvhSahTop != 0;
+	settings.rebuild_threshold = header.rebuildThreshold;
+
+	std::vector<int> objectIndices(view.objectIndices, view.objectIndices + view.objectIndexCount);
+	scene.adoptBVH(std::make_unique<BVH>(std::move(nodes), std::move(objectIndices), settings, header.buildCost));
+}
+
+bool scene_file::load(const std::string& path, scene& scene, std::string& error)
+{
+	mapped_file file;
+	if (!file.open(path))
+	{
+		error = "could not open " + path;
+		return false;
+	}
+
+	view view;
+	if (!open_view(file.data(), file.size(), view, error))
+		return false;
+
+	load(view, scene);
+	return true;
+}
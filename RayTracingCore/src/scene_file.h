@@ -0,0 +1,156 @@
+#pragma once
+#include "scene.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary scene files (.rtscene) hold the objects, meshes, materials, background and the flattened BVH
+// built for them, so opening a large scene costs a page-in and a few linear passes instead of a build.
+// Every section is an array of fixed-size records at a 64 byte aligned offset named in the header,
+// which makes a mapped file addressable in place. Records are stored in the writer's byte order,
+// little endian on everything we build for, and any change to a record needs a new VERSION.
+namespace scene_file
+{
+	constexpr char MAGIC[4]{ 'R', 'T', 'S', 'C' };
+	constexpr uint32_t VERSION{ 2 };
+	constexpr uint64_t ALIGNMENT{ 64 };
+
+	struct section
+	{
+		uint64_t offset; // from the start of the file
+		uint64_t count; // records, not bytes
+	};
+
+	struct file_header
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t fileSize;
+
+		float background[3];
+
+		// BVH::build_settings the stored tree was built with, enums as their underlying values
+		uint32_t strategy;
+		uint32_t layout;
+		int32_t maxLeafSize;
+		int32_t maxDepth;
+		int32_t sahBins;
+		float traversalCost;
+		float intersectionCost;
+		uint32_t lbvhSahTop;
+		float rebuildThreshold;
+		float buildCost;
+		uint32_t reserved;
+
+		section materials;
+		section spheres;
+		section nodes;
+		section objectIndices;
+
+		section meshes;
+		section positions;
+		section normals; // as many as positions, or none if no mesh has normals
+		section indices;
+	};
+
+	enum class material_type : uint32_t
+	{
+		standard,
+		emissive
+	};
+
+	struct material_record
+	{
+		material_type type;
+		float baseColour[3];
+		float roughness;
+		float metallic;
+		float specular;
+		float emissionStrength;
+	};
+
+	// objects, in scene order
+	struct sphere_record
+	{
+		float position[3];
+		float radius;
+		int32_t materialIndex;
+	};
+
+	// a range of the shared vertex and index sections, indices count from the mesh's first vertex
+	struct mesh_record
+	{
+		uint64_t firstVertex;
+		uint64_t vertexCount;
+		uint64_t firstIndex;
+		uint64_t indexCount;
+		int32_t materialIndex;
+		uint32_t hasNormals;
+	};
+
+	struct vector_record
+	{
+		float x, y, z;
+	};
+
+	// BVHNode without the padding and with the extent's slabs spelled out
+	struct node_record
+	{
+		float slabNear[7];
+		float slabFar[7];
+		uint32_t activeSlabs; // bit i set if slab i is in use
+		uint32_t offset;
+		uint32_t count;
+		uint32_t parent;
+		float area;
+		uint32_t leaf;
+	};
+
+	static_assert(sizeof(file_header) == 200 && sizeof(material_record) == 32 && sizeof(sphere_record) == 20 && sizeof(node_record) == 80
+		&& sizeof(mesh_record) == 40 && sizeof(vector_record) == 12,
+		"scene file records must keep their size, change VERSION along with them");
+
+	// the sections of a validated file, pointing into its memory
+	struct view
+	{
+		const file_header* header{};
+		const material_record* materials{};
+		const sphere_record* spheres{};
+		const node_record* nodes{};
+		const int32_t* objectIndices{};
+		const mesh_record* meshes{};
+		const vector_record* positions{};
+		const vector_record* normals{};
+		const uint32_t* indices{};
+
+		size_t materialCount{ 0 };
+		size_t sphereCount{ 0 };
+		size_t nodeCount{ 0 };
+		size_t objectIndexCount{ 0 };
+		size_t meshCount{ 0 };
+		size_t positionCount{ 0 };
+		size_t normalCount{ 0 };
+		size_t indexCount{ 0 };
+		size_t triangleCount{ 0 }; // over all meshes
+	};
+
+	// checks everything loading relies on before anything indexes into the file: the header, section
+	// bounds and alignment, record values, material, object and vertex indices, and that the tree reaches
+	// every node and primitive exactly once within the traversal stack limits. error says what failed
+	bool validate(const void* data, size_t size, std::string& error);
+
+	// validates, then points view at the file's sections
+	bool open_view(const void* data, size_t size, view& view, std::string& error);
+
+	// the scene needs a built BVH, which is stored as built. Instances have no section yet, so a scene
+	// with any isn't written
+	bool write(const scene& scene, const std::string& path);
+
+	// replaces the scene's objects, meshes, materials and background with the file's, drops its instances
+	// and adopts the file's BVH
+	void load(const view& view, scene& scene);
+
+	// maps, validates and loads a file
+	bool load(const std::string& path, scene& scene, std::string& error);
+}
@@ -0,0 +1,316 @@
+#include "scene_generator.h"
+#include "sampler.h"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	void clear(scene& scene)
+	{
+		scene.objects.clear();
+		scene.meshes.clear();
+		scene.instances.clear();
+		scene.materials.clear();
+		scene.bvh.reset();
+		scene.bvh4.reset();
+		scene.bvh8.reset();
+	}
+
+	int addMaterial(scene& scene, const glm::vec3& colour, float roughness, float metallic)
+	{
+		auto added = std::make_unique<material>();
+		added->baseColour = colour;
+		added->roughness = roughness;
+		added->metallic = metallic;
+		scene.materials.push_back(std::move(added));
+		return (int)scene.materials.size() - 1;
+	}
+
+	int addLight(scene& scene, const glm::vec3& colour, float strength)
+	{
+		auto added = std::make_unique<emissive>();
+		added->baseColour = colour;
+		added->emissionStrength = strength;
+		scene.materials.push_back(std::move(added));
+		return (int)scene.materials.size() - 1;
+	}
+
+	void addSphere(scene& scene, const glm::vec3& position, float radius, int materialIndex)
+	{
+		auto added = std::make_unique<sphere>();
+		added->position = position;
+		added->radius = radius;
+		added->material_index = materialIndex;
+		scene.objects.push_back(std::move(added));
+	}
+
+	// a torus around the y axis, tilted about x, with segments around the ring and rings around the tube
+	std::unique_ptr<triangle_mesh> makeTorus(const glm::vec3& centre, float majorRadius, float minorRadius, uint32_t segments, uint32_t rings,
+		float tilt, int materialIndex)
+	{
+		auto added = std::make_unique<triangle_mesh>();
+		added->material_index = materialIndex;
+		added->positions.reserve((size_t)segments * rings);
+		added->normals.reserve((size_t)segments * rings);
+		added->indices.reserve(6 * (size_t)segments * rings);
+
+		float cosTilt = std::cos(tilt);
+		float sinTilt = std::sin(tilt);
+		auto rotate = [&](const glm::vec3& v) { return glm::vec3(v.x, cosTilt * v.y - sinTilt * v.z, sinTilt * v.y + cosTilt * v.z); };
+
+		for (uint32_t i = 0; i < segments; i++)
+		{
+			float u = glm::two_pi<float>() * i / segments;
+			for (uint32_t j = 0; j < rings; j++)
+			{
+				float v = glm::two_pi<float>() * j / rings;
+				glm::vec3 normal{ std::cos(v) * std::cos(u), std::sin(v), std::cos(v) * std::sin(u) };
+				glm::vec3 ring{ majorRadius * std::cos(u), 0.0f, majorRadius * std::sin(u) };
+
+				added->positions.push_back(centre + rotate(ring + minorRadius * normal));
+				added->normals.push_back(rotate(normal));
+			}
+		}
+
+		// neighbouring rows and columns wrap around, so the surface is closed
+		for (uint32_t i = 0; i < segments; i++)
+		{
+			uint32_t next = (i + 1) % segments;
+			for (uint32_t j = 0; j < rings; j++)
+			{
+				uint32_t a = i * rings + j;
+				uint32_t b = next * rings + j;
+				uint32_t c = next * rings + (j + 1) % rings;
+				uint32_t d = i * rings + (j + 1) % rings;
+				added->indices.insert(added->indices.end(), { a, b, c, a, c, d });
+			}
+		}
+
+		return added;
+	}
+
+	// a few diffuse and metal materials and one light to draw from, returns the index of the first
+	int addPalette(scene& scene)
+	{
+		int first = addMaterial(scene, { 0.8f, 0.3f, 0.3f }, 0.6f, 0.0f);
+		addMaterial(scene, { 0.3f, 0.8f, 0.4f }, 0.4f, 0.0f);
+		addMaterial(scene, { 0.3f, 0.4f, 0.8f }, 0.8f, 0.0f);
+		addMaterial(scene, { 0.9f, 0.8f, 0.6f }, 0.2f, 1.0f);
+		addMaterial(scene, { 0.8f, 0.8f, 0.8f }, 0.05f, 1.0f);
+		addLight(scene, { 1.0f, 0.9f, 0.7f }, 6.0f);
+		return first;
+	}
+
+	constexpr int PALETTE_SIZE{ 6 };
+
+	// one in a hundred spheres is a light, the last palette entry
+	int pickMaterial(int first, sampler& rng)
+	{
+		if (rng.get_real() < 0.01f)
+			return first + PALETTE_SIZE - 1;
+
+		return first + std::min((int)(rng.get_real() * (PALETTE_SIZE - 1)), PALETTE_SIZE - 2);
+	}
+
+	// standard normal pair (Box-Muller)
+	glm::vec2 gaussian(sampler& rng)
+	{
+		glm::vec2 u = rng.get_2d();
+		float r = std::sqrt(-2.0f * std::log(1.0f - u.x));
+		float phi = glm::two_pi<float>() * u.y;
+		return { r * std::cos(phi), r * std::sin(phi) };
+	}
+}
+
+void scene_generator::showcase(scene& scene, camera& camera)
+{
+	clear(scene);
+
+	int ground = addMaterial(scene, { 0.5f, 0.5f, 0.5f }, 0.8f, 0.0f);
+	int plastic = addMaterial(scene, { 0.8f, 0.2f, 0.2f }, 0.3f, 0.0f);
+	addMaterial(scene, { 0.9f, 0.8f, 0.6f }, 0.15f, 1.0f);
+	int light = addLight(scene, { 1.0f, 0.9f, 0.7f }, 8.0f);
+
+	addSphere(scene, { 0.0f, -1000.0f, 0.0f }, 999.0f, ground);
+	for (int i = 0; i < 5; i++)
+	{
+		addSphere(scene, { -4.0f + 2.0f * i, 0.0f, -6.0f }, 1.0f, plastic + i % 2);
+	}
+	addSphere(scene, { 0.0f, 5.0f, -4.0f }, 1.0f, light);
+
+	camera.set_view({ 0.0f, 1.0f, 2.0f }, { 0.0f, -0.15f, -1.0f });
+}
+
+void scene_generator::random_spheres(scene& scene, camera& camera, size_t count, uint32_t seed)
+{
+	clear(scene);
+	int palette = addPalette(scene);
+
+	// about one sphere per 8 units of volume whatever the count
+	float side = 2.0f * std::cbrt((float)count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		sampler rng(seed, (uint32_t)i, 0);
+		glm::vec3 position = (glm::vec3(rng.get_real(), rng.get_real(), rng.get_real()) - 0.5f) * side;
+		float radius = 0.1f + 0.4f * rng.get_real();
+		addSphere(scene, position, radius, pickMaterial(palette, rng));
+	}
+
+	camera.set_view({ 0.0f, 0.0f, 0.5f * side + 2.0f }, { 0.0f, 0.0f, -1.0f });
+}
+
+void scene_generator::clustered_spheres(scene& scene, camera& camera, size_t count, uint32_t seed)
+{
+	clear(scene);
+	int palette = addPalette(scene);
+
+	// the same bounds as random_spheres, but the spheres only fill the space around a few centres
+	float side = 2.0f * std::cbrt((float)count);
+	size_t clusterCount = std::max<size_t>(1, (size_t)std::cbrt((float)count));
+	float spread = 0.05f * side;
+
+	std::vector<glm::vec3> centres(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		sampler rng(seed, (uint32_t)c, 1);
+		centres[c] = (glm::vec3(rng.get_real(), rng.get_real(), rng.get_real()) - 0.5f) * 0.8f * side;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		sampler rng(seed, (uint32_t)i, 0);
+		const glm::vec3& centre = centres[std::min((size_t)(rng.get_real() * clusterCount), clusterCount - 1)];
+
+		glm::vec2 a = gaussian(rng);
+		glm::vec2 b = gaussian(rng);
+		float radius = 0.05f + 0.2f * rng.get_real();
+		addSphere(scene, centre + glm::vec3(a.x, a.y, b.x) * spread, radius, pickMaterial(palette, rng));
+	}
+
+	camera.set_view({ 0.0f, 0.0f, 0.5f * side + 2.0f }, { 0.0f, 0.0f, -1.0f });
+}
+
+void scene_generator::cornell_room(scene& scene, camera& camera, size_t count, uint32_t seed)
+{
+	clear(scene);
+
+	int white = addMaterial(scene, { 0.75f, 0.75f, 0.75f }, 1.0f, 0.0f);
+	int red = addMaterial(scene, { 0.75f, 0.15f, 0.15f }, 1.0f, 0.0f);
+	int green = addMaterial(scene, { 0.15f, 0.75f, 0.15f }, 1.0f, 0.0f);
+	int metal = addMaterial(scene, { 0.9f, 0.9f, 0.9f }, 0.05f, 1.0f);
+	int light = addLight(scene, { 1.0f, 0.85f, 0.7f }, 15.0f);
+
+	// the room spans [-5, 5] on every axis and is open towards the camera, each wall is a sphere
+	// big enough to look flat from inside
+	constexpr float HALF_SIZE{ 5.0f };
+	constexpr float WALL_RADIUS{ 1000.0f };
+
+	addSphere(scene, { -HALF_SIZE - WALL_RADIUS, 0.0f, 0.0f }, WALL_RADIUS, red);
+	addSphere(scene, { HALF_SIZE + WALL_RADIUS, 0.0f, 0.0f }, WALL_RADIUS, green);
+	addSphere(scene, { 0.0f, -HALF_SIZE - WALL_RADIUS, 0.0f }, WALL_RADIUS, white);
+	addSphere(scene, { 0.0f, HALF_SIZE + WALL_RADIUS, 0.0f }, WALL_RADIUS, white);
+	addSphere(scene, { 0.0f, 0.0f, -HALF_SIZE - WALL_RADIUS }, WALL_RADIUS, white);
+
+	addSphere(scene, { 0.0f, HALF_SIZE - 0.5f, 0.0f }, 0.8f, light);
+	addSphere(scene, { -2.0f, -HALF_SIZE + 1.5f, -1.5f }, 1.5f, metal);
+	addSphere(scene, { 2.0f, -HALF_SIZE + 1.5f, 1.0f }, 1.5f, white);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		sampler rng(seed, (uint32_t)i, 0);
+		float radius = 0.1f + 0.2f * rng.get_real();
+		glm::vec2 u = rng.get_2d();
+		glm::vec3 position{ (u.x - 0.5f) * 2.0f * (HALF_SIZE - radius), -HALF_SIZE + radius, (u.y - 0.5f) * 2.0f * (HALF_SIZE - radius) };
+		addSphere(scene, position, radius, red + std::min((int)(rng.get_real() * 3), 2));
+	}
+
+	camera.set_view({ 0.0f, 0.0f, 3.0f * HALF_SIZE }, { 0.0f, 0.0f, -1.0f });
+}
+
+void scene_generator::mesh_tori(scene& scene, camera& camera, size_t count, uint32_t seed)
+{
+	clear(scene);
+	int palette = addPalette(scene);
+	int ground = addMaterial(scene, { 0.5f, 0.5f, 0.5f }, 0.8f, 0.0f);
+
+	addSphere(scene, { 0.0f, -1000.0f, 0.0f }, 999.0f, ground);
+	addSphere(scene, { 0.0f, 6.0f, -4.0f }, 1.0f, palette + PALETTE_SIZE - 1);
+
+	// each torus has twice as many segments as rings and two triangles per quad
+	constexpr int TORUS_COUNT{ 5 };
+	uint32_t rings = std::max(3u, (uint32_t)std::sqrt((float)count / (4.0f * TORUS_COUNT)));
+
+	for (int i = 0; i < TORUS_COUNT; i++)
+	{
+		sampler rng(seed, (uint32_t)i, 0);
+		float tilt = glm::half_pi<float>() * rng.get_real();
+		int materialIndex = palette + std::min((int)(rng.get_real() * (PALETTE_SIZE - 1)), PALETTE_SIZE - 2);
+		scene.meshes.push_back(makeTorus({ -4.0f + 2.0f * i, 0.0f, -6.0f }, 0.7f, 0.25f, 2 * rings, rings, tilt, materialIndex));
+	}
+
+	camera.set_view({ 0.0f, 1.0f, 2.0f }, { 0.0f, -0.15f, -1.0f });
+}
+
+void scene_generator::instanced_tori(scene& scene, camera& camera, size_t count, uint32_t seed)
+{
+	clear(scene);
+	int palette = addPalette(scene);
+	int ground = addMaterial(scene, { 0.5f, 0.5f, 0.5f }, 0.8f, 0.0f);
+
+	// a square with sqrt(count) tori along each side, about two and a half units apart
+	float side = 2.5f * std::sqrt((float)std::max<size_t>(count, 1));
+
+	addSphere(scene, { 0.0f, -10000.0f, 0.0f }, 10000.0f, ground);
+	addSphere(scene, { 0.0f, 0.5f * side + 4.0f, 0.0f }, 0.05f * side + 1.0f, palette + PALETTE_SIZE - 1);
+
+	// every copy shares one torus and its BVH, only the scene's BVH grows with the count
+	std::vector<std::unique_ptr<triangle_mesh>> meshes;
+	meshes.push_back(makeTorus(glm::vec3(0.0f), 0.7f, 0.25f, 96, 48, 0.0f, 0));
+
+	BVH::build_settings settings;
+	settings.strategy = BVH::build_strategy::sah;
+	auto torus = std::make_shared<const instance_geometry>(std::vector<std::unique_ptr<object>>{}, std::move(meshes), settings);
+
+	scene.instances.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		sampler rng(seed, (uint32_t)i, 0);
+		glm::vec2 u = rng.get_2d();
+		float scale = 0.5f + 0.7f * rng.get_real();
+		float turn = glm::two_pi<float>() * rng.get_real();
+		float tilt = glm::half_pi<float>() * rng.get_real();
+
+		// turned about y after tilting about x, so every torus still stands on the ground
+		glm::mat3 turnY(glm::vec3(std::cos(turn), 0.0f, -std::sin(turn)), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(std::sin(turn), 0.0f, std::cos(turn)));
+		glm::mat3 tiltX(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, std::cos(tilt), std::sin(tilt)), glm::vec3(0.0f, -std::sin(tilt), std::cos(tilt)));
+
+		glm::vec3 position{ (u.x - 0.5f) * side, 0.95f * scale, (u.y - 0.5f) * side };
+		auto added = std::make_unique<instance>(torus, position, pickMaterial(palette, rng));
+		added->set_basis(turnY * tiltX * scale);
+		scene.instances.push_back(std::move(added));
+	}
+
+	camera.set_view({ 0.0f, 0.25f * side + 2.0f, 0.6f * side + 4.0f }, glm::normalize(glm::vec3(0.0f, -0.45f, -1.0f)));
+}
+
+bool scene_generator::generate(const std::string& name, size_t count, uint32_t seed, scene& scene, camera& camera)
+{
+	if (name == "showcase")
+		showcase(scene, camera);
+	else if (name == "random")
+		random_spheres(scene, camera, count, seed);
+	else if (name == "clustered")
+		clustered_spheres(scene, camera, count, seed);
+	else if (name == "cornell")
+		cornell_room(scene, camera, count, seed);
+	else if (name == "tori")
+		mesh_tori(scene, camera, count, seed);
+	else if (name == "instances")
+		instanced_tori(scene, camera, count, seed);
+	else
+		return false;
+
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "scene.h"
+#include "camera.h"
+#include <string>
+
+// Procedural scenes for the command line renderer and the benchmarks. Each one replaces the scene's
+// objects, meshes, instances and materials and points the camera at them, building the scene's BVH is
+// left to the caller.
+// Placement uses the counter-based sampler, so a scene is the same for a seed on every platform.
+namespace scene_generator
+{
+	// a row of plastic and metal spheres on a ground sphere, lit by one small light and the sky
+	void showcase(scene& scene, camera& camera);
+
+	// count spheres of random size spread evenly through a cube that grows with the count
+	void random_spheres(scene& scene, camera& camera, size_t count, uint32_t seed);
+
+	// count spheres packed into a few dense clusters with empty space between them
+	void clustered_spheres(scene& scene, camera& camera, size_t count, uint32_t seed);
+
+	// walls made of huge spheres, a light under the ceiling and count small spheres on the floor
+	void cornell_room(scene& scene, camera& camera, size_t count, uint32_t seed);
+
+	// about count triangles shared between a row of tilted, smooth shaded tori above a ground sphere
+	void mesh_tori(scene& scene, camera& camera, size_t count, uint32_t seed);
+
+	// count instances of one shared torus scattered over a ground sphere, each turned, tilted and scaled.
+	// The torus' own BVH is built here with SAH, once for all of them
+	void instanced_tori(scene& scene, camera& camera, size_t count, uint32_t seed);
+
+	// one of "showcase", "random", "clustered", "cornell", "tori" or "instances", false for anything else
+	bool generate(const std::string& name, size_t count, uint32_t seed, scene& scene, camera& camera);
+}
@@ -0,0 +1,34 @@
+#include "simd.h"
+
+#if RT_SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+simd::level simd::detect()
+{
+#if RT_SIMD_X86
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+
+	// AVX needs both the CPU and the OS (which has to save the YMM registers on context switches)
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool ymm_state = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+
+	if (avx && avx2 && fma && ymm_state)
+		return level::avx2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return level::avx2;
+#endif
+	return level::sse;
+#else
+	return level::scalar;
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Instruction set selection for the vectorised kernels. SSE is part of the x64 baseline,
+// AVX2 kernels are compiled per function and only called after checking the CPU at runtime.
+#if defined(_M_X64) || defined(__x86_64__)
+#define RT_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define RT_SIMD_X86 0
+#endif
+
+#if RT_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define RT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define RT_TARGET_AVX2
+#endif
+
+namespace simd
+{
+	enum class level
+	{
+		scalar,
+		sse,
+		avx2
+	};
+
+	level detect();
+
+	// best instruction set of the CPU we are running on, queried once
+	inline level get()
+	{
+		static const level supported = detect();
+		return supported;
+	}
+}
@@ -0,0 +1,330 @@
+#include "sphere_set.h"
+#include "instance.h"
+
+namespace
+{
+	// Same quadratic as sphere::hit: q takes the sign of b so the roots are computed without cancellation,
+	// and the smaller root is the entry point. Kernels return a mask of the lanes hit in [tMin, closestT).
+
+	int sphere_hits_scalar(const sphere_set& set, const ray& r, uint32_t begin, uint32_t count, float tMin, float closestT, float* distances)
+	{
+		float a = glm::dot(r.direction, r.direction);
+		int mask = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t p = begin + i;
+			if (set.radius[p] < 0.0f)
+				continue;
+
+			glm::vec3 oc = r.origin - set.center(p);
+			float b = 2.0f * glm::dot(r.direction, oc);
+			float c = glm::dot(oc, oc) - set.radius[p] * set.radius[p];
+			float discriminant = b * b - 4.0f * a * c;
+
+			if (discriminant < 0.0f)
+				continue;
+
+			float q = (b > 0) ? -0.5f * (b + sqrt(discriminant)) : -0.5f * (b - sqrt(discriminant));
+			float t = std::min(q / a, c / q);
+
+			distances[i] = t;
+			if (t >= tMin && t < closestT)
+			{
+				mask |= 1 << i;
+			}
+		}
+
+		return mask;
+	}
+
+#if RT_SIMD_X86
+	int sphere_hits_sse(const sphere_set& set, const ray& r, uint32_t begin, uint32_t count, float tMin, float closestT, float* distances)
+	{
+		__m128 a = _mm_set1_ps(glm::dot(r.direction, r.direction));
+		__m128 four_a = _mm_mul_ps(_mm_set1_ps(4.0f), a);
+		__m128 direction_x = _mm_set1_ps(r.direction.x);
+		__m128 direction_y = _mm_set1_ps(r.direction.y);
+		__m128 direction_z = _mm_set1_ps(r.direction.z);
+
+		__m128 oc_x = _mm_sub_ps(_mm_set1_ps(r.origin.x), _mm_loadu_ps(&set.center_x[begin]));
+		__m128 oc_y = _mm_sub_ps(_mm_set1_ps(r.origin.y), _mm_loadu_ps(&set.center_y[begin]));
+		__m128 oc_z = _mm_sub_ps(_mm_set1_ps(r.origin.z), _mm_loadu_ps(&set.center_z[begin]));
+		__m128 radius = _mm_loadu_ps(&set.radius[begin]);
+
+		__m128 half_b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(direction_x, oc_x), _mm_mul_ps(direction_y, oc_y)), _mm_mul_ps(direction_z, oc_z));
+		__m128 b = _mm_add_ps(half_b, half_b);
+		__m128 c = _mm_sub_ps(
+			_mm_add_ps(_mm_add_ps(_mm_mul_ps(oc_x, oc_x), _mm_mul_ps(oc_y, oc_y)), _mm_mul_ps(oc_z, oc_z)),
+			_mm_mul_ps(radius, radius));
+		__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four_a, c));
+
+		__m128 sign = _mm_and_ps(b, _mm_set1_ps(-0.0f));
+		__m128 root = _mm_or_ps(_mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps())), sign);
+		__m128 q = _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_add_ps(b, root));
+		__m128 t = _mm_min_ps(_mm_div_ps(q, a), _mm_div_ps(c, q));
+
+		__m128 valid = _mm_and_ps(_mm_cmpge_ps(discriminant, _mm_setzero_ps()), _mm_cmpge_ps(radius, _mm_setzero_ps()));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(t, _mm_set1_ps(tMin)), _mm_cmplt_ps(t, _mm_set1_ps(closestT))));
+
+		_mm_storeu_ps(distances, t);
+		return _mm_movemask_ps(valid) & ((1 << std::min(count, 4u)) - 1);
+	}
+
+	RT_TARGET_AVX2 int sphere_hits_avx2(const sphere_set& set, const ray& r, uint32_t begin, uint32_t count, float tMin, float closestT, float* distances)
+	{
+		__m256 a = _mm256_set1_ps(glm::dot(r.direction, r.direction));
+		__m256 four_a = _mm256_mul_ps(_mm256_set1_ps(4.0f), a);
+
+		__m256 oc_x = _mm256_sub_ps(_mm256_set1_ps(r.origin.x), _mm256_loadu_ps(&set.center_x[begin]));
+		__m256 oc_y = _mm256_sub_ps(_mm256_set1_ps(r.origin.y), _mm256_loadu_ps(&set.center_y[begin]));
+		__m256 oc_z = _mm256_sub_ps(_mm256_set1_ps(r.origin.z), _mm256_loadu_ps(&set.center_z[begin]));
+		__m256 radius = _mm256_loadu_ps(&set.radius[begin]);
+
+		__m256 half_b = _mm256_fmadd_ps(_mm256_set1_ps(r.direction.z), oc_z,
+			_mm256_fmadd_ps(_mm256_set1_ps(r.direction.y), oc_y, _mm256_mul_ps(_mm256_set1_ps(r.direction.x), oc_x)));
+		__m256 b = _mm256_add_ps(half_b, half_b);
+		__m256 c = _mm256_fmadd_ps(oc_z, oc_z, _mm256_fmadd_ps(oc_y, oc_y, _mm256_fnmadd_ps(radius, radius, _mm256_mul_ps(oc_x, oc_x))));
+		__m256 discriminant = _mm256_fnmadd_ps(four_a, c, _mm256_mul_ps(b, b));
+
+		__m256 sign = _mm256_and_ps(b, _mm256_set1_ps(-0.0f));
+		__m256 root = _mm256_or_ps(_mm256_sqrt_ps(_mm256_max_ps(discriminant, _mm256_setzero_ps())), sign);
+		__m256 q = _mm256_mul_ps(_mm256_set1_ps(-0.5f), _mm256_add_ps(b, root));
+		__m256 t = _mm256_min_ps(_mm256_div_ps(q, a), _mm256_div_ps(c, q));
+
+		__m256 valid = _mm256_and_ps(
+			_mm256_cmp_ps(discriminant, _mm256_setzero_ps(), _CMP_GE_OQ),
+			_mm256_cmp_ps(radius, _mm256_setzero_ps(), _CMP_GE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_and_ps(
+			_mm256_cmp_ps(t, _mm256_set1_ps(tMin), _CMP_GE_OQ),
+			_mm256_cmp_ps(t, _mm256_set1_ps(closestT), _CMP_LT_OQ)));
+
+		_mm256_storeu_ps(distances, t);
+		return _mm256_movemask_ps(valid) & ((1 << std::min(count, 8u)) - 1);
+	}
+#endif
+}
+
+void sphere_set::build(const BVH& bvh, const primitive_list& objects)
+{
+	m_objects = &objects;
+	object_index = bvh.object_indices;
+
+	size_t padded = object_index.size() + PADDING;
+	center_x.assign(padded, 0.0f);
+	center_y.assign(padded, 0.0f);
+	center_z.assign(padded, 0.0f);
+	radius.assign(padded, -1.0f);
+
+	m_primitives.assign(objects.object_count() + objects.instance_count(), 0);
+	m_allSpheres = true;
+	m_anySpheres = false;
+
+	for (uint32_t p = 0; p < object_index.size(); p++)
+	{
+		if (!objects.is_triangle(object_index[p]))
+			m_primitives[tracked_index(object_index[p])] = p;
+		store(p);
+	}
+}
+
+void sphere_set::update(const std::vector<int>& dirty_objects)
+{
+	for (int index : dirty_objects)
+	{
+		store(m_primitives[tracked_index(index)]);
+	}
+}
+
+size_t sphere_set::tracked_index(uint32_t index) const
+{
+	return m_objects->is_instance(index) ? m_objects->object_count() + (index - m_objects->first_instance()) : index;
+}
+
+void sphere_set::store(uint32_t primitive)
+{
+	uint32_t index = object_index[primitive];
+	glm::vec3 centre = m_objects->get_centre(index);
+	center_x[primitive] = centre.x;
+	center_y[primitive] = centre.y;
+	center_z[primitive] = centre.z;
+
+	bool isObject = !m_objects->is_triangle(index) && !m_objects->is_instance(index);
+	const sphere* s = isObject ? dynamic_cast<const sphere*>(&m_objects->get_object(index)) : nullptr;
+	if (s)
+	{
+		radius[primitive] = s->radius;
+		m_anySpheres = true;
+	}
+	else
+	{
+		radius[primitive] = -1.0f;
+		m_allSpheres = false;
+	}
+}
+
+float sphere_set::hit(const ray& ray, uint32_t primitive, float tMin, float tMax, int& instancePrimitive) const
+{
+	return hit(ray, triangle_mesh::sheared_ray(ray), primitive, tMin, tMax, instancePrimitive);
+}
+
+float sphere_set::hit(const ray& ray, const triangle_mesh::sheared_ray& sheared, uint32_t primitive, float tMin, float tMax, int& instancePrimitive) const
+{
+	uint32_t index = object_index[primitive];
+	if (m_objects->is_triangle(index))
+	{
+		uint32_t triangle;
+		return m_objects->get_mesh(index, triangle).hit(triangle, sheared);
+	}
+
+	// an instance holds many primitives, the range lets its own traversal skip the ones outside it
+	if (m_objects->is_instance(index))
+		return m_objects->get_instance(index).hit(ray, tMin, tMax, instancePrimitive);
+
+	return m_objects->get_object(index).hit(ray);
+}
+
+bool sphere_set::occludes(const ray& ray, const triangle_mesh::sheared_ray& sheared, uint32_t primitive, float tMin, float tMax) const
+{
+	uint32_t index = object_index[primitive];
+	if (m_objects->is_instance(index))
+		return m_objects->get_instance(index).occluded(ray, tMin, tMax);
+
+	int instancePrimitive;
+	float t = hit(ray, sheared, primitive, tMin, tMax, instancePrimitive);
+	return t >= tMin && t < tMax;
+}
+
+glm::vec3 sphere_set::normal(uint32_t primitive, const glm::vec3& position, const glm::vec3& direction) const
+{
+	if (is_sphere(primitive))
+		return (position - center(primitive)) / radius[primitive];
+
+	uint32_t index = object_index[primitive];
+	if (m_objects->is_triangle(index))
+	{
+		uint32_t triangle;
+		const triangle_mesh& mesh = m_objects->get_mesh(index, triangle);
+		return mesh.getNormalAt(triangle, position, direction);
+	}
+
+	return m_objects->get_object(index).getNormalAt(position);
+}
+
+int sphere_set::intersect(const ray& ray, uint32_t begin, uint32_t count, float tMin, float& closestT, int& instancePrimitive) const
+{
+	int closest = -1;
+	alignas(32) float distances[8];
+
+	auto pick = [&](uint32_t first, int mask)
+	{
+		for (int i = 0; mask; i++, mask >>= 1)
+		{
+			if ((mask & 1) && distances[i] < closestT)
+			{
+				closestT = distances[i];
+				closest = (int)(first + i);
+			}
+		}
+	};
+
+	// leaves of a mesh-only scene skip the sphere kernels entirely
+	uint32_t sphereEnd = m_anySpheres ? begin + count : begin;
+
+	[[maybe_unused]] simd::level level = simd::get();
+	for (uint32_t first = begin; first < sphereEnd;)
+	{
+		uint32_t remaining = sphereEnd - first;
+
+#if RT_SIMD_X86
+		if (level >= simd::level::avx2 && remaining > 4)
+		{
+			pick(first, sphere_hits_avx2(*this, ray, first, remaining, tMin, closestT, distances));
+			first += 8;
+			continue;
+		}
+		if (level >= simd::level::sse)
+		{
+			pick(first, sphere_hits_sse(*this, ray, first, remaining, tMin, closestT, distances));
+			first += 4;
+			continue;
+		}
+#endif
+		uint32_t lanes = std::min(remaining, 8u);
+		pick(first, sphere_hits_scalar(*this, ray, first, lanes, tMin, closestT, distances));
+		first += lanes;
+	}
+
+	// anything that isn't a sphere goes through its own hit test
+	if (!m_allSpheres)
+	{
+		triangle_mesh::sheared_ray sheared(ray);
+		for (uint32_t p = begin; p < begin + count; p++)
+		{
+			if (radius[p] >= 0.0f)
+				continue;
+
+			int hitPrimitive = -1;
+			float t = hit(ray, sheared, p, tMin, closestT, hitPrimitive);
+			if (t >= tMin && t < closestT)
+			{
+				closestT = t;
+				closest = (int)p;
+				instancePrimitive = hitPrimitive;
+			}
+		}
+	}
+
+	return closest;
+}
+
+bool sphere_set::occluded(const ray& ray, uint32_t begin, uint32_t count, float tMin, float tMax) const
+{
+	alignas(32) float distances[8];
+
+	uint32_t sphereEnd = m_anySpheres ? begin + count : begin;
+
+	[[maybe_unused]] simd::level level = simd::get();
+	for (uint32_t first = begin; first < sphereEnd;)
+	{
+		uint32_t remaining = sphereEnd - first;
+		int mask;
+
+#if RT_SIMD_X86
+		if (level >= simd::level::avx2 && remaining > 4)
+		{
+			mask = sphere_hits_avx2(*this, ray, first, remaining, tMin, tMax, distances);
+			first += 8;
+		}
+		else if (level >= simd::level::sse)
+		{
+			mask = sphere_hits_sse(*this, ray, first, remaining, tMin, tMax, distances);
+			first += 4;
+		}
+		else
+#endif
+		{
+			uint32_t lanes = std::min(remaining, 8u);
+			mask = sphere_hits_scalar(*this, ray, first, lanes, tMin, tMax, distances);
+			first += lanes;
+		}
+
+		if (mask)
+			return true;
+	}
+
+	if (!m_allSpheres)
+	{
+		triangle_mesh::sheared_ray sheared(ray);
+		for (uint32_t p = begin; p < begin + count; p++)
+		{
+			if (radius[p] >= 0.0f)
+				continue;
+
+			if (occludes(ray, sheared, p, tMin, tMax))
+				return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "BVH.h"
+#include "simd.h"
+
+// Sphere centres and radii packed as structure of arrays in BVH leaf order, so a leaf's range of
+// BVH::object_indices addresses them directly and several spheres are tested per instruction.
+// This is the hot-path copy of the scene's objects; primitives that aren't spheres keep a negative
+// radius and are intersected as triangles, instances or through object::hit instead.
+class sphere_set
+{
+public:
+	std::vector<float> center_x;
+	std::vector<float> center_y;
+	std::vector<float> center_z;
+	std::vector<float> radius;
+	std::vector<int> object_index;
+
+	// the arrays are padded so a full vector can always be loaded from the last leaf
+	static constexpr size_t PADDING{ 8 };
+
+	void build(const BVH& bvh, const primitive_list& objects);
+
+	// copies the new centre and radius of moved objects and instances
+	void update(const std::vector<int>& dirty_objects);
+
+	// closest hit among primitives [begin, begin + count), returns the primitive index or -1 and narrows closestT.
+	// An instance hit also sets instancePrimitive to the primitive of its geometry, so it needn't be found again
+	int intersect(const ray& ray, uint32_t begin, uint32_t count, float tMin, float& closestT, int& instancePrimitive) const;
+
+	// true as soon as any primitive in [begin, begin + count) is hit in [tMin, tMax)
+	bool occluded(const ray& ray, uint32_t begin, uint32_t count, float tMin, float tMax) const;
+
+	size_t size() const { return object_index.size(); }
+	bool is_sphere(uint32_t primitive) const { return radius[primitive] >= 0.0f; }
+	glm::vec3 center(uint32_t primitive) const { return { center_x[primitive], center_y[primitive], center_z[primitive] }; }
+
+	// distance to a primitive that isn't a sphere, -1 on a miss. Instances only report hits in [tMin, tMax)
+	// and set instancePrimitive to the primitive of their geometry that was hit
+	float hit(const ray& ray, uint32_t primitive, float tMin, float tMax, int& instancePrimitive) const;
+
+	// surface normal where the ray hit a primitive at position, facing the ray for triangles.
+	// Instances need their own lookup with the primitive of their geometry, see instance::getNormalAt
+	glm::vec3 normal(uint32_t primitive, const glm::vec3& position, const glm::vec3& direction) const;
+
+private:
+	const primitive_list* m_objects{};
+	std::vector<uint32_t> m_primitives; // primitive index of each object, then of each instance
+	bool m_allSpheres{ true };
+	bool m_anySpheres{ true };
+
+	float hit(const ray& ray, const triangle_mesh::sheared_ray& sheared, uint32_t primitive, float tMin, float tMax, int& instancePrimitive) const;
+	bool occludes(const ray& ray, const triangle_mesh::sheared_ray& sheared, uint32_t primitive, float tMin, float tMax) const;
+
+	// slot in m_primitives, triangles never move and have none
+	size_t tracked_index(uint32_t index) const;
+
+	void store(uint32_t primitive);
+};
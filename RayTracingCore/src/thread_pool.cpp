@@ -0,0 +1,146 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+thread_pool::thread_pool(uint32_t threadCount, bool pinThreads)
+	: m_pinned(pinThreads)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_queues.push_back(std::make_unique<task_queue>());
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&thread_pool::worker_loop, this, i);
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void thread_pool::run(uint32_t taskCount, const std::function<void(uint32_t, uint32_t)>& job)
+{
+	if (taskCount == 0)
+		return;
+
+	m_job = &job;
+	m_steals.store(0, std::memory_order_relaxed);
+	m_remaining.store(taskCount);
+
+	// tasks are dealt round robin and pushed in reverse, so every worker pops its share in task order
+	// and a thief takes the task its owner would have reached last
+	uint32_t workers = size();
+	for (uint32_t task = taskCount; task-- > 0;)
+	{
+		task_queue& queue = *m_queues[task % workers];
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+
+	std::unique_lock lock(m_mutex);
+	m_generation++;
+	m_wake.notify_all();
+	m_done.wait(lock, [this] { return m_remaining.load() == 0; });
+	m_job = nullptr;
+}
+
+void thread_pool::worker_loop(uint32_t worker)
+{
+	if (m_pinned)
+		pin_current_thread(worker % std::max(1u, std::thread::hardware_concurrency()));
+
+	uint64_t generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+			if (m_stop)
+				return;
+
+			generation = m_generation;
+		}
+
+		// the queue mutex a task was popped under orders this read after the write of m_job in run
+		uint32_t task;
+		while (pop(worker, task))
+		{
+			(*m_job)(task, worker);
+
+			if (m_remaining.fetch_sub(1) == 1)
+			{
+				std::lock_guard lock(m_mutex);
+				m_done.notify_all();
+			}
+		}
+	}
+}
+
+bool thread_pool::pop(uint32_t worker, uint32_t& task)
+{
+	{
+		task_queue& own = *m_queues[worker];
+		std::lock_guard lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	uint32_t workers = size();
+	for (uint32_t i = 1; i < workers; i++)
+	{
+		task_queue& victim = *m_queues[(worker + i) % workers];
+		std::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			m_steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void thread_pool::pin_current_thread(uint32_t core)
+{
+#if defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)core;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads with one task deque each. A batch of tasks is dealt round robin over the
+// deques, every worker pops its own tasks in order and steals from the far end of another deque once
+// its own runs dry, so uneven tasks still finish together.
+class thread_pool
+{
+public:
+	// threadCount 0 uses one thread per hardware thread, pinThreads binds worker i to core i
+	thread_pool(uint32_t threadCount, bool pinThreads);
+	~thread_pool();
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	// runs job(task, worker) for every task in [0, taskCount) and returns once all of them are done
+	void run(uint32_t taskCount, const std::function<void(uint32_t task, uint32_t worker)>& job);
+
+	uint32_t size() const { return (uint32_t)m_threads.size(); }
+	bool is_pinned() const { return m_pinned; }
+
+	// tasks taken from another worker's deque during the last run
+	uint32_t get_steal_count() const { return m_steals.load(std::memory_order_relaxed); }
+
+private:
+	struct task_queue
+	{
+		std::mutex mutex;
+		std::deque<uint32_t> tasks;
+	};
+
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<task_queue>> m_queues;
+	bool m_pinned{ false };
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	uint64_t m_generation{ 0 };
+	bool m_stop{ false };
+
+	const std::function<void(uint32_t, uint32_t)>* m_job{};
+	std::atomic<uint32_t> m_remaining{ 0 };
+	std::atomic<uint32_t> m_steals{ 0 };
+
+	void worker_loop(uint32_t worker);
+	bool pop(uint32_t worker, uint32_t& task);
+
+	static void pin_current_thread(uint32_t core);
+};
@@ -0,0 +1,138 @@
+#include "tile_scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	uint32_t spread_bits(uint32_t v)
+	{
+		v &= 0xffff;
+		v = (v | (v << 8)) & 0x00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+}
+
+void tile_scheduler::configure(uint32_t width, uint32_t height, const settings& settings)
+{
+	tile_scheduler::settings clamped = settings;
+	clamped.tileSize = std::max(1, settings.tileSize);
+	clamped.threadCount = std::max(0, settings.threadCount);
+
+	if (!m_pool || clamped.threadCount != m_settings.threadCount || clamped.pinThreads != m_settings.pinThreads)
+	{
+		m_pool.reset();
+		m_pool = std::make_unique<thread_pool>((uint32_t)clamped.threadCount, clamped.pinThreads);
+	}
+
+	bool retile = m_tiles.empty() || width != m_width || height != m_height
+		|| clamped.tileSize != m_settings.tileSize || clamped.order != m_settings.order;
+
+	m_settings = clamped;
+	m_width = width;
+	m_height = height;
+
+	if (retile)
+		build_tiles();
+}
+
+void tile_scheduler::build_tiles()
+{
+	m_tiles.clear();
+
+	uint32_t size = (uint32_t)m_settings.tileSize;
+	uint32_t tilesX = (m_width + size - 1) / size;
+	uint32_t tilesY = (m_height + size - 1) / size;
+
+	struct keyed_tile
+	{
+		float key0;
+		float key1;
+		tile bounds;
+	};
+	std::vector<keyed_tile> keyed;
+	keyed.reserve(tilesX * tilesY);
+
+	float centreX = 0.5f * (tilesX - 1.0f);
+	float centreY = 0.5f * (tilesY - 1.0f);
+
+	for (uint32_t ty = 0; ty < tilesY; ty++)
+	{
+		for (uint32_t tx = 0; tx < tilesX; tx++)
+		{
+			tile t{ tx * size, ty * size, std::min((tx + 1) * size, m_width), std::min((ty + 1) * size, m_height) };
+
+			switch (m_settings.order)
+			{
+			case tile_order::scanline:
+				keyed.push_back({ (float)ty, (float)tx, t });
+				break;
+			case tile_order::morton:
+				keyed.push_back({ (float)(spread_bits(tx) | (spread_bits(ty) << 1)), 0.0f, t });
+				break;
+			case tile_order::spiral:
+			{
+				// ring around the centre first, then the angle within the ring
+				float dx = tx - centreX;
+				float dy = ty - centreY;
+				keyed.push_back({ std::round(std::max(std::abs(dx), std::abs(dy))), std::atan2(dy, dx), t });
+				break;
+			}
+			}
+		}
+	}
+
+	std::stable_sort(keyed.begin(), keyed.end(), [](const keyed_tile& a, const keyed_tile& b)
+	{
+		return a.key0 < b.key0 || (a.key0 == b.key0 && a.key1 < b.key1);
+	});
+
+	for (const keyed_tile& k : keyed)
+	{
+		m_tiles.push_back(k.bounds);
+	}
+	m_timings.assign(m_tiles.size(), {});
+}
+
+void tile_scheduler::run(const std::function<void(const tile&)>& renderTile)
+{
+	using clock = std::chrono::steady_clock;
+
+	m_pool->run((uint32_t)m_tiles.size(), [&](uint32_t task, uint32_t worker)
+	{
+		clock::time_point start = clock::now();
+		renderTile(m_tiles[task]);
+		m_timings[task] = { std::chrono::duration<float, std::milli>(clock::now() - start).count(), worker };
+	});
+}
+
+tile_scheduler::frame_stats tile_scheduler::get_stats() const
+{
+	frame_stats stats{};
+	if (m_timings.empty() || !m_pool)
+		return stats;
+
+	std::vector<float> busy(m_pool->size(), 0.0f);
+	float total = 0.0f;
+	stats.minTileMs = m_timings[0].ms;
+
+	for (const tile_timing& timing : m_timings)
+	{
+		stats.minTileMs = std::min(stats.minTileMs, timing.ms);
+		stats.maxTileMs = std::max(stats.maxTileMs, timing.ms);
+		total += timing.ms;
+		busy[timing.worker] += timing.ms;
+	}
+
+	stats.meanTileMs = total / m_timings.size();
+
+	float meanBusy = total / busy.size();
+	if (meanBusy > 0.0f)
+		stats.imbalance = *std::max_element(busy.begin(), busy.end()) / meanBusy;
+
+	stats.steals = m_pool->get_steal_count();
+	return stats;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "thread_pool.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Splits a frame into square tiles and renders them on a thread_pool. The tile order decides which
+// part of the image is finished first, per-tile timings show where the frame time goes.
+class tile_scheduler
+{
+public:
+	enum class tile_order
+	{
+		scanline,
+		morton,
+		spiral // outwards from the centre of the image
+	};
+
+	struct settings
+	{
+		int tileSize{ 32 };
+		tile_order order{ tile_order::spiral };
+		int threadCount{ 0 }; // 0 uses every hardware thread
+		bool pinThreads{ false };
+	};
+
+	struct tile
+	{
+		uint32_t x0, y0;
+		uint32_t x1, y1; // exclusive
+	};
+
+	struct tile_timing
+	{
+		float ms;
+		uint32_t worker;
+	};
+
+	struct frame_stats
+	{
+		float minTileMs{};
+		float meanTileMs{};
+		float maxTileMs{};
+		float imbalance{}; // busiest worker over the average worker, 1 is perfectly balanced
+		uint32_t steals{};
+	};
+
+	// recreates the tiles or the thread pool when the frame size or settings changed
+	void configure(uint32_t width, uint32_t height, const settings& settings);
+
+	// calls renderTile once for every tile and waits for all of them
+	void run(const std::function<void(const tile&)>& renderTile);
+
+	const std::vector<tile>& get_tiles() const { return m_tiles; }
+	const std::vector<tile_timing>& get_timings() const { return m_timings; } // indexed like get_tiles
+	frame_stats get_stats() const;
+	uint32_t get_thread_count() const { return m_pool ? m_pool->size() : 0; }
+
+private:
+	std::unique_ptr<thread_pool> m_pool{};
+	std::vector<tile> m_tiles{};
+	std::vector<tile_timing> m_timings{};
+
+	settings m_settings{};
+	uint32_t m_width{ 0 };
+	uint32_t m_height{ 0 };
+
+	void build_tiles();
+};
@@ -0,0 +1,147 @@
+#include "triangle_mesh.h"
+#include <algorithm>
+
+triangle_mesh::sheared_ray::sheared_ray(const ray& ray)
+	: origin(ray.origin)
+{
+	// the largest direction component becomes z, x and y are swapped for negative z to keep the winding
+	glm::vec3 size = glm::abs(ray.direction);
+	kz = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	kx = (kz + 1) % 3;
+	ky = (kx + 1) % 3;
+	if (ray.direction[kz] < 0.0f)
+		std::swap(kx, ky);
+
+	sx = ray.direction[kx] / ray.direction[kz];
+	sy = ray.direction[ky] / ray.direction[kz];
+	sz = 1.0f / ray.direction[kz];
+}
+
+extent triangle_mesh::get_extent(uint32_t triangle, const std::vector<int>& normal_indices) const
+{
+	glm::vec3 a = vertex(triangle, 0);
+	glm::vec3 b = vertex(triangle, 1);
+	glm::vec3 c = vertex(triangle, 2);
+
+	extent extent{};
+	for (int normal_index : normal_indices)
+	{
+		const glm::vec3& normal = extent::plane_set_normals[normal_index];
+		float da = glm::dot(a, normal);
+		float db = glm::dot(b, normal);
+		float dc = glm::dot(c, normal);
+
+		extent.slabs[normal_index] = { std::min({ da, db, dc }), std::max({ da, db, dc }) };
+		extent.active.set(normal_index);
+	}
+
+	return extent;
+}
+
+glm::vec3 triangle_mesh::get_centroid(uint32_t triangle) const
+{
+	return (vertex(triangle, 0) + vertex(triangle, 1) + vertex(triangle, 2)) / 3.0f;
+}
+
+float triangle_mesh::hit(uint32_t triangle, const sheared_ray& ray) const
+{
+	// Woop, Benthin and Wald: in the sheared space the ray is the z axis, so the edge functions are 2D
+	// cross products that neighbouring triangles compute from bit-identical inputs
+	glm::vec3 a = vertex(triangle, 0) - ray.origin;
+	glm::vec3 b = vertex(triangle, 1) - ray.origin;
+	glm::vec3 c = vertex(triangle, 2) - ray.origin;
+
+	float ax = a[ray.kx] - ray.sx * a[ray.kz];
+	float ay = a[ray.ky] - ray.sy * a[ray.kz];
+	float bx = b[ray.kx] - ray.sx * b[ray.kz];
+	float by = b[ray.ky] - ray.sy * b[ray.kz];
+	float cx = c[ray.kx] - ray.sx * c[ray.kz];
+	float cy = c[ray.ky] - ray.sy * c[ray.kz];
+
+	float u = cx * by - cy * bx;
+	float v = ax * cy - ay * cx;
+	float w = bx * ay - by * ax;
+
+	// an exact zero means the ray passes through an edge, redo it in double so the sign is right
+	if (u == 0.0f || v == 0.0f || w == 0.0f)
+	{
+		u = (float)((double)cx * by - (double)cy * bx);
+		v = (float)((double)ax * cy - (double)ay * cx);
+		w = (float)((double)bx * ay - (double)by * ax);
+	}
+
+	if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+		return -1;
+
+	float determinant = u + v + w;
+	if (determinant == 0.0f)
+		return -1;
+
+	float az = ray.sz * a[ray.kz];
+	float bz = ray.sz * b[ray.kz];
+	float cz = ray.sz * c[ray.kz];
+	float t = (u * az + v * bz + w * cz) / determinant;
+
+	return t > 0.0f ? t : -1;
+}
+
+glm::vec3 triangle_mesh::getNormalAt(uint32_t triangle, const glm::vec3& worldPosition, const glm::vec3& direction) const
+{
+	glm::vec3 a = vertex(triangle, 0);
+	glm::vec3 b = vertex(triangle, 1);
+	glm::vec3 c = vertex(triangle, 2);
+
+	glm::vec3 geometric = glm::cross(b - a, c - a);
+	float area = glm::dot(geometric, geometric);
+	if (area == 0.0f)
+		return -direction;
+
+	// barycentrics of the hit from the areas of the triangles it splits this one into, measured against
+	// the winding's own normal so they keep their sign whichever side the ray came from
+	float wa = glm::clamp(glm::dot(glm::cross(b - worldPosition, c - worldPosition), geometric) / area, 0.0f, 1.0f);
+	float wb = glm::clamp(glm::dot(glm::cross(c - worldPosition, a - worldPosition), geometric) / area, 0.0f, 1.0f);
+	float wc = glm::max(0.0f, 1.0f - wa - wb);
+
+	if (glm::dot(geometric, direction) > 0.0f)
+		geometric = -geometric;
+
+	if (normals.empty())
+		return glm::normalize(geometric);
+
+	glm::vec3 shading = wa * normals[indices[3 * triangle]] + wb * normals[indices[3 * triangle + 1]] + wc * normals[indices[3 * triangle + 2]];
+	if (glm::dot(shading, shading) == 0.0f)
+		return glm::normalize(geometric);
+
+	// interpolated normals are kept on the side of the surface the ray arrived at
+	shading = glm::normalize(shading);
+	return glm::dot(shading, geometric) < 0.0f ? -shading : shading;
+}
+
+void triangle_mesh::compute_normals()
+{
+	normals.assign(positions.size(), glm::vec3(0.0f));
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		glm::vec3 a = positions[indices[i]];
+		glm::vec3 face = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+
+		normals[indices[i]] += face;
+		normals[indices[i + 1]] += face;
+		normals[indices[i + 2]] += face;
+	}
+
+	for (glm::vec3& normal : normals)
+	{
+		float length = glm::length(normal);
+		normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+	}
+}
+
+bool triangle_mesh::is_valid() const
+{
+	if (indices.size() % 3 != 0 || (!normals.empty() && normals.size() != positions.size()))
+		return false;
+
+	return std::all_of(indices.begin(), indices.end(), [&](uint32_t index) { return index < positions.size(); });
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "ray.h"
+#include "extent.h"
+#include <vector>
+#include <cstdint>
+
+// An indexed triangle mesh. Vertices are shared between triangles through the index buffer and
+// the BVH is built over the individual triangles, so no triangle is ever stored on its own.
+class triangle_mesh
+{
+public:
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals; // per vertex, empty for flat shading
+	std::vector<uint32_t> indices; // three per triangle
+
+	int material_index{ 0 };
+
+	// a ray transformed for the watertight triangle test, set up once and reused for every triangle it meets
+	struct sheared_ray
+	{
+		glm::vec3 origin;
+		int kx, ky, kz; // axes permuted so the ray runs along kz
+		float sx, sy, sz; // shear onto the z axis
+
+		explicit sheared_ray(const ray& ray);
+	};
+
+	size_t triangle_count() const { return indices.size() / 3; }
+
+	glm::vec3 vertex(uint32_t triangle, int corner) const { return positions[indices[3 * triangle + corner]]; }
+
+	extent get_extent(uint32_t triangle, const std::vector<int>& normal_indices) const;
+
+	glm::vec3 get_centroid(uint32_t triangle) const;
+
+	// distance along the ray to the triangle, -1 on a miss. Watertight: a ray through a shared edge or
+	// vertex hits at least one of the triangles meeting there
+	float hit(uint32_t triangle, const sheared_ray& ray) const;
+
+	// shading normal at a point on the triangle, facing the side the ray came from
+	glm::vec3 getNormalAt(uint32_t triangle, const glm::vec3& worldPosition, const glm::vec3& direction) const;
+
+	// area weighted vertex normals, for meshes whose file had none
+	void compute_normals();
+
+	// checks the index buffer and normal count, true if the mesh can be built and traced
+	bool is_valid() const;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the newest value from one producer thread to one consumer thread without locks. Each side owns a
+// slot and the third sits in the middle: the producer fills its slot and swaps it into the middle, the
+// consumer swaps the middle out once something fresh is there. Neither side ever waits, and values the
+// consumer didn't get to are overwritten, so it always reads the latest.
+template <typename T>
+class triple_buffer
+{
+public:
+	explicit triple_buffer(const T& initial = T{})
+		: m_slots{ { initial, initial, initial } }
+	{
+	}
+
+	triple_buffer(const triple_buffer&) = delete;
+	triple_buffer& operator=(const triple_buffer&) = delete;
+
+	// producer: fill this slot, then publish it
+	T& write_slot() { return m_slots[m_write]; }
+
+	void publish()
+	{
+		m_write = m_middle.exchange(m_write | FRESH) & INDEX;
+	}
+
+	// consumer: true if something was published since the last call, read_slot() is then the newest value
+	bool update()
+	{
+		if (!(m_middle.load() & FRESH))
+			return false;
+
+		m_read = m_middle.exchange(m_read) & INDEX;
+		return true;
+	}
+
+	const T& read_slot() const { return m_slots[m_read]; }
+
+private:
+	static constexpr uint32_t INDEX{ 3 };
+	static constexpr uint32_t FRESH{ 4 };
+
+	std::array<T, 3> m_slots;
+	uint32_t m_write{ 0 };			// only touched by the producer
+	std::atomic<uint32_t> m_middle{ 1 };	// slot index, FRESH until the consumer takes it
+	uint32_t m_read{ 2 };			// only touched by the consumer
+};
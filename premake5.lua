@@ -1,10 +1,31 @@
 -- premake5.lua
+newoption
+{
+   trigger = "headless",
+   description = "Only generate the core library, command line renderer and benchmarks, without Walnut or Vulkan"
+}
+
 workspace "RayTracing"
    architecture "x64"
    configurations { "Debug", "Release", "Dist" }
-   startproject "RayTracing"
+   startproject (_OPTIONS["headless"] and "RayTracingCLI" or "RayTracing")
+
+   -- per frame ray counters (ray_stats.h), compiled out of Dist builds
+   filter "configurations:Debug or Release"
+      defines { "RT_RAY_STATS" }
+
+   filter {}
 
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
-include "Walnut/WalnutExternal.lua"
 
-include "RayTracing"
\ No newline at end of file
+if not _OPTIONS["headless"] then
+   include "Walnut/WalnutExternal.lua"
+end
+
+include "RayTracingCore"
+include "RayTracingCLI"
+include "RayTracingBench"
+
+if not _OPTIONS["headless"] then
+   include "RayTracing"
+end
@@ -0,0 +1,6 @@
+#!/bin/sh
+# Generates makefiles for the core library and command line renderer only, no Vulkan SDK needed.
+# premake5 has to be on the PATH, glm comes from the Walnut submodule.
+
+cd "$(dirname "$0")/.."
+premake5 --headless gmake2